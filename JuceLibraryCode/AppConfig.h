@@ -18,6 +18,13 @@
 
 // (You can add your own code in this section, and the Projucer will not overwrite it)
 
+// Source/StandaloneApp.cpp provides the standalone app, tuned for low-latency live use. Only the
+// Linux Makefile exporter defines PLUGINTEMPLATE_LOW_LATENCY_STANDALONE, so every other exporter
+// keeps JUCE's own standalone app and links whether or not it compiles StandaloneApp.cpp
+#if PLUGINTEMPLATE_LOW_LATENCY_STANDALONE
+ #define JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP 1
+#endif
+
 // [END_USER_CODE_SECTION]
 
 #include "JucePluginDefines.h"
@@ -87,7 +94,7 @@
 #endif
 
 #ifndef    JUCE_JACK
- //#define JUCE_JACK 0
+ #define   JUCE_JACK 1
 #endif
 
 #ifndef    JUCE_BELA
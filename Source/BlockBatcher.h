@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    BlockBatcher.h
+
+    Collects the host's blocks into fixed batches, so a host calling with
+    tiny buffers still gets processed in big ones, at a fixed latency.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SubBlockEngine.h"
+
+//==============================================================================
+/**
+    The input is copied into one batch while the previous, processed batch
+    is played back out of the other. A batch is processed as soon as it's
+    full, and then the two swap. Whatever the host's block sizes, the output
+    is always exactly batchSize samples behind the input. That is the
+    latency to report.
+
+    A batch is one whole sub-block, so a full batch is one pass through the
+    processing chain. Between batches a host call only copies samples.
+
+    The copies are cheap, but all of a batch's work lands in the one host
+    call that fills it. So this is for renders and other work that nobody
+    monitors live, not for a small realtime buffer close to its deadline.
+*/
+class BlockBatcher
+{
+public:
+    static constexpr int batchSize = SubBlockEngine::maxSubBlockSize;
+
+    BlockBatcher() = default;
+
+    //==============================================================================
+    /** numChannels is every channel of the process buffer: inputs, outputs and sidechain. */
+    void prepare (int numChannels)
+    {
+        for (auto& batch : batches)
+            batch.setSize (jmax (1, numChannels), batchSize);
+
+        reset();
+    }
+
+    /** Silence out until the next batch is full. */
+    void reset() noexcept
+    {
+        for (auto& batch : batches)
+            batch.clear();
+
+        filling = 0;
+        position = 0;
+    }
+
+    static constexpr int getLatencySamples() noexcept      { return batchSize; }
+    int getNumChannels() const noexcept                     { return batches[0].getNumChannels(); }
+
+    //==============================================================================
+    /** Swaps the buffer's samples for the ones a batch ago. processBatch (AudioBuffer<float>&)
+        is called in place on every batch that fills along the way.
+    */
+    template <typename ProcessFunction>
+    void process (AudioBuffer<float>& buffer, ProcessFunction&& processBatch)
+    {
+        auto numChannels = jmin (buffer.getNumChannels(), batches[0].getNumChannels());
+        auto numSamples = buffer.getNumSamples();
+
+        for (int done = 0; done < numSamples;)
+        {
+            auto numThisTime = jmin (numSamples - done, batchSize - position);
+            auto& input = batches[filling];
+            auto& output = batches[1 - filling];
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                input.copyFrom (channel, position, buffer, channel, done, numThisTime);
+                buffer.copyFrom (channel, done, output, channel, position, numThisTime);
+            }
+
+            position += numThisTime;
+            done += numThisTime;
+
+            // the batch just filled is played back next, and the one just emptied is filled
+            if (position == batchSize)
+            {
+                processBatch (input);
+                filling = 1 - filling;
+                position = 0;
+            }
+        }
+    }
+
+private:
+    AudioBuffer<float> batches[2];
+    int filling = 0, position = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockBatcher)
+};
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    CoefficientTable.h
+
+    Low-pass biquad coefficients precomputed on a log-frequency grid, so a
+    modulated cutoff costs a table lookup instead of a filter design.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    makeLowPass() needs a tan() and a handful of divisions, which is fine when
+    a user moves a knob but too much when an envelope moves the cutoff every
+    few samples. This table holds its results every 1/48 of an octave from
+    20 Hz to 20 kHz, and lookup() interpolates linearly between neighbours.
+
+    Any mix of two stable biquads' (a1, a2) pairs is itself stable, so the
+    interpolated filters are always stable too.
+*/
+class LowPassCoefficientTable
+{
+public:
+    static constexpr float minFrequency = 20.0f;
+    static constexpr float maxFrequency = 20000.0f;
+    static constexpr int pointsPerOctave = 48;
+    static constexpr int numPoints = 10 * pointsPerOctave + 1;      // a little over log2 (1000) octaves
+
+    LowPassCoefficientTable() = default;
+
+    //==============================================================================
+    /** Rebuilds the table for a new sample rate; call this off the audio thread. */
+    void prepare (double sampleRate)
+    {
+        for (int point = 0; point < numPoints; ++point)
+        {
+            auto frequency = minFrequency * std::exp2 ((double) point / pointsPerOctave);
+            auto lowPass = IIRCoefficients::makeLowPass (sampleRate, jmin (frequency, sampleRate * 0.49));
+
+            std::copy (lowPass.coefficients, lowPass.coefficients + 5, table[(size_t) point].begin());
+        }
+    }
+
+    /** Writes { b0, b1, b2, a1, a2 } for the given cutoff into coefficients. */
+    void lookup (float frequency, float* coefficients) const noexcept
+    {
+        auto position = std::log2 (jlimit (minFrequency, maxFrequency, frequency) / minFrequency) * (float) pointsPerOctave;
+        auto index = jmin ((int) position, numPoints - 2);
+        auto frac = position - (float) index;
+
+        auto& lower = table[(size_t) index];
+        auto& upper = table[(size_t) index + 1];
+
+        for (size_t i = 0; i < 5; ++i)
+            coefficients[i] = lower[i] + frac * (upper[i] - lower[i]);
+    }
+
+private:
+    std::array<std::array<float, 5>, numPoints> table {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowPassCoefficientTable)
+};
@@ -0,0 +1,432 @@
+/*
+  ==============================================================================
+
+    ConvolutionEngine.h
+
+    Zero-latency, non-uniformly partitioned convolution for long impulse
+    responses.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FFT.h"
+
+//==============================================================================
+/**
+    One impulse response channel cut into equal partitions, stored as the
+    spectra of each zero-padded partition. Built once, read-only afterwards.
+*/
+struct ConvolutionPartitions
+{
+    using Complex = RealFFT::Complex;
+
+    void build (RealFFT& fft, const float* ir, int irLength, int partitionSize, int firstTap)
+    {
+        numBins = fft.getNumBins();
+        numPartitions = jmax (0, (irLength - firstTap + partitionSize - 1) / partitionSize);
+        spectra.assign ((size_t) (numPartitions * numBins), {});
+
+        std::vector<float> padded ((size_t) fft.getSize());
+
+        for (int p = 0; p < numPartitions; ++p)
+        {
+            auto start = firstTap + p * partitionSize;
+            auto length = jmin (partitionSize, irLength - start);
+
+            std::fill (padded.begin(), padded.end(), 0.0f);
+            std::copy (ir + start, ir + start + length, padded.begin());
+
+            fft.forward (padded.data(), getSpectrum (p));
+        }
+    }
+
+    Complex* getSpectrum (int partition) noexcept               { return spectra.data() + partition * numBins; }
+    const Complex* getSpectrum (int partition) const noexcept   { return spectra.data() + partition * numBins; }
+
+    int numPartitions = 0, numBins = 0;
+    std::vector<Complex> spectra;
+};
+
+//==============================================================================
+/**
+    Uniformly partitioned overlap-save convolution state for one channel.
+
+    Every call to processBlock() pushes one partition-sized block of input and
+    produces the next partition-sized block of output. Which output block that
+    is depends on the first tap of the partitions: a set starting at tap
+    d * partitionSize yields output that is due d - 1 blocks later, which is
+    what lets us run the head on the audio thread and the tail elsewhere.
+*/
+class UniformConvolver
+{
+public:
+    using Complex = RealFFT::Complex;
+
+    void prepare (int partitionSizeToUse, int numPartitions, int numBins)
+    {
+        partitionSize = partitionSizeToUse;
+
+        window.assign ((size_t) (2 * partitionSize), 0.0f);
+        timeDomain.assign ((size_t) (2 * partitionSize), 0.0f);
+        accumulator.assign ((size_t) numBins, {});
+        delayLine.assign ((size_t) (jmax (1, numPartitions) * numBins), {});
+        delayLineSize = jmax (1, numPartitions);
+        newest = 0;
+    }
+
+    void reset()
+    {
+        std::fill (window.begin(), window.end(), 0.0f);
+        std::fill (delayLine.begin(), delayLine.end(), Complex());
+        newest = 0;
+    }
+
+    void processBlock (RealFFT& fft, const ConvolutionPartitions& partitions,
+                       const float* input, float* output) noexcept
+    {
+        pushBlock (fft, input);
+        computeOutput (fft, partitions, output);
+    }
+
+    /** Adds one block of input to the frequency-domain delay line. */
+    void pushBlock (RealFFT& fft, const float* input) noexcept
+    {
+        // slide the 2 * partitionSize input window along by one block
+        std::copy (window.begin() + partitionSize, window.end(), window.begin());
+        std::copy (input, input + partitionSize, window.begin() + partitionSize);
+
+        newest = (newest + delayLineSize - 1) % delayLineSize;
+        fft.forward (window.data(), delayLine.data() + newest * (int) accumulator.size());
+    }
+
+    /** Convolves the delay line with a set of partitions. The delay line doesn't
+        depend on the kernel, so this can be called with several kernels per block.
+    */
+    void computeOutput (RealFFT& fft, const ConvolutionPartitions& partitions, float* output) noexcept
+    {
+        auto numBins = partitions.numBins;
+
+        std::fill (accumulator.begin(), accumulator.end(), Complex());
+
+        for (int p = 0; p < partitions.numPartitions; ++p)
+        {
+            auto* x = delayLine.data() + ((newest + p) % delayLineSize) * numBins;
+            auto* h = partitions.getSpectrum (p);
+            auto* acc = accumulator.data();
+
+            for (int bin = 0; bin < numBins; ++bin)
+                acc[bin] += x[bin] * h[bin];
+        }
+
+        fft.inverse (accumulator.data(), timeDomain.data());
+        std::copy (timeDomain.begin() + partitionSize, timeDomain.end(), output);
+    }
+
+private:
+    int partitionSize = 0, delayLineSize = 1, newest = 0;
+    std::vector<float> window, timeDomain;
+    std::vector<Complex> accumulator, delayLine;
+};
+
+//==============================================================================
+/**
+    Convolves up to two channels with an impulse response at zero latency.
+
+    The response is split three ways:
+      - taps [0, headSize) run as a direct-form FIR, sample by sample;
+      - taps [headSize, 2 * tailBlockSize) run as headSize partitions on the
+        audio thread, computed once every headSize samples;
+      - everything after that runs as tailBlockSize partitions on a background
+        thread, which gets a whole tailBlockSize period to deliver each block.
+
+    A mono response is shared by both channels. Construct off the audio thread;
+    process() never allocates, locks or waits. If the background thread misses
+    a deadline the tail for that block is dropped and counted rather than
+    stalling the audio thread.
+
+    Offline there's no deadline, only a render that can run far faster than
+    real time, so with setSynchronousTail (true) each tail block is computed
+    on the calling thread as it's submitted and nothing is ever dropped.
+*/
+class ConvolutionEngine  : private Thread
+{
+public:
+    using Complex = RealFFT::Complex;
+
+    static constexpr int maxChannels = 2;
+    static constexpr int headSize = 64;
+    static constexpr int tailBlockSize = 1024;
+
+    ConvolutionEngine (const AudioBuffer<float>& impulseResponse)
+        : Thread ("Convolution tail"),
+          headFFT (fftOrderFor (headSize)), tailFFT (fftOrderFor (tailBlockSize))
+    {
+        static_assert (tailBlockSize % headSize == 0, "tail blocks must line up with head blocks");
+
+        irLength = impulseResponse.getNumSamples();
+        numKernels = jlimit (1, maxChannels, impulseResponse.getNumChannels());
+
+        for (int k = 0; k < numKernels; ++k)
+        {
+            auto* ir = impulseResponse.getReadPointer (k);
+            auto& kernel = kernels[k];
+
+            kernel.head.assign ((size_t) headSize, 0.0f);
+
+            // stored reversed so the FIR is a straight dot product over the history
+            for (int i = 0; i < jmin (headSize, irLength); ++i)
+                kernel.head[(size_t) (headSize - 1 - i)] = ir[i];
+
+            kernel.body.build (headFFT, ir, jmin (irLength, 2 * tailBlockSize), headSize, headSize);
+            kernel.tail.build (tailFFT, ir, irLength, tailBlockSize, 2 * tailBlockSize);
+        }
+
+        for (auto& state : states)
+        {
+            state.history.assign ((size_t) (2 * headSize), 0.0f);
+            state.bodyInput.assign ((size_t) headSize, 0.0f);
+            state.bodyOutput.assign ((size_t) headSize, 0.0f);
+            state.body.prepare (headSize, kernels[0].body.numPartitions, headFFT.getNumBins());
+            state.tail.prepare (tailBlockSize, kernels[0].tail.numPartitions, tailFFT.getNumBins());
+
+            for (int slot = 0; slot < numSlots; ++slot)
+            {
+                state.tailInput[slot].assign ((size_t) tailBlockSize, 0.0f);
+                state.tailOutput[slot].assign ((size_t) tailBlockSize, 0.0f);
+            }
+        }
+
+        if (hasTail())
+            startThread (8);
+    }
+
+    ~ConvolutionEngine() override
+    {
+        stopThread (2000);
+    }
+
+    //==============================================================================
+    int getImpulseResponseLength() const noexcept   { return irLength; }
+    bool hasTail() const noexcept                   { return kernels[0].tail.numPartitions > 0; }
+
+    /** Number of tail blocks the background thread delivered too late to play. */
+    int getNumLateTailBlocks() const noexcept       { return lateTailBlocks.load(); }
+
+    /** Not for real-time use: process() then takes a lock and does the tail's work itself. */
+    void setSynchronousTail (bool shouldBeSynchronous) noexcept    { synchronousTail = shouldBeSynchronous; }
+
+    /** Only call this while the audio thread is not processing. */
+    void reset()
+    {
+        for (auto& state : states)
+        {
+            std::fill (state.history.begin(), state.history.end(), 0.0f);
+            std::fill (state.bodyOutput.begin(), state.bodyOutput.end(), 0.0f);
+            state.body.reset();
+        }
+
+        headPosition = 0;
+        tailPosition = 0;
+        currentTailBlock = 0;
+        tailReady = false;
+
+        const ScopedLock sl (tailLock);
+        tailBlocksSubmitted = 0;
+        tailBlocksDone = 0;
+
+        for (auto& state : states)
+            state.tail.reset();
+    }
+
+    //==============================================================================
+    /** Replaces the contents of each channel with its convolution. */
+    void process (float* const* channels, int numChannels, int numSamples) noexcept
+    {
+        numChannels = jmin (numChannels, maxChannels);
+
+        for (int done = 0; done < numSamples;)
+        {
+            auto numThisTime = jmin (numSamples - done, headSize - headPosition);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                processChannel (channel, channels[channel] + done, numThisTime);
+
+            done += numThisTime;
+            headPosition += numThisTime;
+            tailPosition += numThisTime;
+
+            if (headPosition == headSize)
+            {
+                headPosition = 0;
+
+                if (kernels[0].body.numPartitions > 0)
+                    for (int channel = 0; channel < numChannels; ++channel)
+                    {
+                        auto& state = states[channel];
+                        state.body.processBlock (headFFT, getKernel (channel).body,
+                                                 state.bodyInput.data(), state.bodyOutput.data());
+                    }
+            }
+
+            if (tailPosition == tailBlockSize)
+            {
+                tailPosition = 0;
+                submitTailBlock();
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr int numSlots = 4;
+
+    /** Partitions of size n are transformed with 2n-point FFTs. */
+    static constexpr int fftOrderFor (int partitionSize)
+    {
+        int order = 1;
+
+        while ((1 << order) < 2 * partitionSize)
+            ++order;
+
+        return order;
+    }
+
+    struct Kernel
+    {
+        std::vector<float> head;
+        ConvolutionPartitions body, tail;
+    };
+
+    struct ChannelState
+    {
+        std::vector<float> history, bodyInput, bodyOutput;
+        UniformConvolver body, tail;
+        std::vector<float> tailInput[numSlots], tailOutput[numSlots];
+    };
+
+    RealFFT headFFT, tailFFT;
+    Kernel kernels[maxChannels];
+    ChannelState states[maxChannels];
+    int irLength = 0, numKernels = 1;
+
+    // audio thread only
+    int headPosition = 0, tailPosition = 0;
+    int64 currentTailBlock = 0;
+    bool tailReady = false, synchronousTail = false;
+
+    // handed between the audio thread and the tail thread
+    std::atomic<int64> tailBlocksSubmitted { 0 }, tailBlocksDone { 0 };
+    std::atomic<int> lateTailBlocks { 0 };
+    CriticalSection tailLock;
+
+    const Kernel& getKernel (int channel) const noexcept    { return kernels[jmin (channel, numKernels - 1)]; }
+
+    void processChannel (int channel, float* data, int numSamples) noexcept
+    {
+        auto& state = states[channel];
+        auto* head = getKernel (channel).head.data();
+        auto* history = state.history.data();
+        auto* tailIn  = state.tailInput [currentTailBlock % numSlots].data() + tailPosition;
+        auto* tailOut = state.tailOutput[currentTailBlock % numSlots].data() + tailPosition;
+        auto* bodyIn  = state.bodyInput.data() + headPosition;
+        auto* bodyOut = state.bodyOutput.data() + headPosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = data[i];
+            auto write = (headPosition + i) % headSize;
+
+            // the history is stored twice so the last headSize inputs are always contiguous
+            history[write] = x;
+            history[write + headSize] = x;
+
+            auto* recent = history + write + 1;
+            float sums[4] = {};
+
+            // four independent sums so the compiler can keep this in vector registers
+            for (int tap = 0; tap < headSize; tap += 4)
+                for (int lane = 0; lane < 4; ++lane)
+                    sums[lane] += head[tap + lane] * recent[tap + lane];
+
+            auto y = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+
+            bodyIn[i] = x;
+            tailIn[i] = x;
+
+            y += bodyOut[i];
+
+            if (tailReady)
+                y += tailOut[i];
+
+            data[i] = y;
+        }
+    }
+
+    void submitTailBlock() noexcept
+    {
+        if (! hasTail())
+            return;
+
+        tailBlocksSubmitted.store (++currentTailBlock, std::memory_order_release);
+
+        if (synchronousTail)
+        {
+            const ScopedLock sl (tailLock);
+            processSubmittedTailBlocks();
+        }
+        else
+        {
+            notify();
+        }
+
+        // block n is computed from input block n - 2, so it has had a full block to arrive
+        tailReady = currentTailBlock >= 2
+                     && tailBlocksDone.load (std::memory_order_acquire) >= currentTailBlock - 1;
+
+        if (currentTailBlock >= 2 && ! tailReady)
+            ++lateTailBlocks;
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait (100);
+
+            const ScopedLock sl (tailLock);
+            processSubmittedTailBlocks();
+        }
+    }
+
+    // called with tailLock held
+    void processSubmittedTailBlocks() noexcept
+    {
+        for (;;)
+        {
+            auto submitted = tailBlocksSubmitted.load (std::memory_order_acquire);
+            auto block = tailBlocksDone.load (std::memory_order_relaxed);
+
+            if (block >= submitted || threadShouldExit())
+                break;
+
+            // too far behind: the input slots have been reused, so catch up
+            if (submitted - block >= numSlots - 1)
+                block = submitted - 1;
+
+            for (int channel = 0; channel < maxChannels; ++channel)
+            {
+                auto& state = states[channel];
+                state.tail.processBlock (tailFFT, getKernel (channel).tail,
+                                         state.tailInput[block % numSlots].data(),
+                                         state.tailOutput[(block + 2) % numSlots].data());
+            }
+
+            tailBlocksDone.store (block + 1, std::memory_order_release);
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionEngine)
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    CpuGovernor.h
+
+    Watches how much of each block's deadline processing takes, and picks a
+    quality level that keeps it comfortably inside.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    The governor only decides on a level, from 0 (full quality) up to
+    maxLevel; what each level gives up is the owner's business.
+
+    Load is the time a block took as a fraction of the time it covers. It's
+    averaged over roughly averagingSeconds. Once the average passes
+    stepDownLoad, or a block misses its deadline outright, the level goes up
+    one. The governor then waits holdSeconds before it looks again, so the
+    cheaper settings have time to show up in the average.
+
+    Going back up needs the average to stay under stepUpLoad for
+    stepUpSeconds. The gap between the two loads is the hysteresis. A level
+    that has to be left again soon after being restored doubles the wait
+    before the next try, up to maxStepUpSeconds, so a machine that sits right
+    on the edge doesn't flap between two levels.
+
+    Everything here runs on the audio thread and never allocates.
+*/
+class CpuGovernor
+{
+public:
+    static constexpr int maxLevel = 2;
+    static constexpr float stepDownLoad = 0.8f;
+    static constexpr float stepUpLoad = 0.5f;
+    static constexpr double averagingSeconds = 0.25;
+    static constexpr double holdSeconds = 0.5;
+    static constexpr double stepUpSeconds = 2.0;
+    static constexpr double maxStepUpSeconds = 30.0;
+
+    CpuGovernor() = default;
+
+    //==============================================================================
+    void prepare (double newSampleRate) noexcept
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    /** Back to full quality, with no history. */
+    void reset() noexcept
+    {
+        level = 0;
+        averageLoad = 0.0f;
+        holdSamples = 0;
+        samplesUnderStepUpLoad = 0;
+        samplesSinceStepUp = -1;
+        stepUpWait = stepUpSeconds;
+    }
+
+    /** Call after every block with how long it took as a fraction of its deadline.
+        Returns true when the level has changed.
+    */
+    bool addBlock (float load, int numSamples) noexcept
+    {
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return false;
+
+        // a one-pole average whose time constant doesn't depend on the block size
+        auto amount = (float) (1.0 - std::exp (-(double) numSamples / (averagingSeconds * sampleRate)));
+        averageLoad += amount * (load - averageLoad);
+
+        if (samplesSinceStepUp >= 0)
+            samplesSinceStepUp += numSamples;
+
+        if (holdSamples > 0)
+        {
+            holdSamples -= numSamples;
+
+            // only a missed deadline gets through the hold
+            if (load <= 1.0f)
+                return false;
+        }
+
+        if ((load > 1.0f || averageLoad > stepDownLoad) && level < maxLevel)
+        {
+            // back down again straight after stepping up: that level wasn't affordable yet
+            if (samplesSinceStepUp >= 0 && samplesSinceStepUp < secondsToSamples (stepUpWait + holdSeconds))
+                stepUpWait = jmin (maxStepUpSeconds, stepUpWait * 2.0);
+
+            ++level;
+            holdSamples = secondsToSamples (holdSeconds);
+            samplesUnderStepUpLoad = 0;
+            samplesSinceStepUp = -1;
+            return true;
+        }
+
+        samplesUnderStepUpLoad = averageLoad < stepUpLoad ? samplesUnderStepUpLoad + numSamples : 0;
+
+        if (level > 0 && samplesUnderStepUpLoad >= secondsToSamples (stepUpWait))
+        {
+            --level;
+            holdSamples = secondsToSamples (holdSeconds);
+            samplesUnderStepUpLoad = 0;
+            samplesSinceStepUp = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    int getLevel() const noexcept               { return level; }
+    float getAverageLoad() const noexcept       { return averageLoad; }
+
+private:
+    double sampleRate = 44100.0;
+    int level = 0;
+    float averageLoad = 0.0f;
+    int64 holdSamples = 0, samplesUnderStepUpLoad = 0, samplesSinceStepUp = -1;
+    double stepUpWait = stepUpSeconds;
+
+    int64 secondsToSamples (double seconds) const noexcept
+    {
+        return (int64) (seconds * sampleRate);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CpuGovernor)
+};
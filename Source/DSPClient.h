@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    DSPClient.h
+
+    Client side of the DSP server: streams audio through a DSPServer's
+    processor from another local process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SharedAudioRing.h"
+
+//==============================================================================
+/**
+    For zero-copy streaming, keep several blocks in flight:
+
+        while (more audio)
+        {
+            if (auto* channels = client.getNextBlock())      // nullptr when every slot is out
+            {
+                ...write up to getMaxBlockSize() samples into channels...
+                client.submitBlock (numSamples);
+            }
+            else
+            {
+                int numSamples;
+                auto* processed = client.waitForProcessedBlock (numSamples);
+                ...read numSamples from processed...
+            }
+        }
+
+    Blocks come back in the order they went in. What waitForProcessedBlock()
+    returns stays valid until that slot is handed out again by getNextBlock().
+
+    process() does one buffer at a time with copies, which is simpler when
+    throughput doesn't matter. None of this is meant for a realtime thread.
+*/
+class DSPClient  : private InterProcessConnection
+{
+public:
+    struct Options
+    {
+        int numChannels = 2;
+        int maxBlockSize = 512;
+        int numSlots = 8;
+        double sampleRate = 48000.0;
+        bool nonRealtime = true;        // offline quality, as in a bounce
+        MemoryBlock state;              // from getStateInformation(); empty for the defaults
+    };
+
+    DSPClient()
+        : InterProcessConnection (false, SharedAudioRing::connectionMagic)
+    {
+    }
+
+    ~DSPClient() override
+    {
+        disconnect();
+        closeRing();
+    }
+
+    //==============================================================================
+    /** Connects to a server on this machine, waits for it to make a ring and
+        build and prepare a processor for us, and maps the ring.
+    */
+    Result connect (int port, const Options& options, int timeoutMs = 5000)
+    {
+        disconnect();
+        closeRing();
+
+        nextToFill = nextToCollect = 0;
+        numSubmitted = 0;
+        numCollected = 0;
+        numDone.store (0);
+        lost.store (false);
+        replied.reset();
+        answered = false;
+
+        if (! connectToSocket ("127.0.0.1", port, timeoutMs))
+            return Result::fail ("No server on port " + String (port));
+
+        MemoryOutputStream hello;
+        hello.writeInt (SharedAudioRing::hello);
+        hello.writeInt (options.numChannels);
+        hello.writeInt (options.maxBlockSize);
+        hello.writeInt (options.numSlots);
+        hello.writeDouble (options.sampleRate);
+        hello.writeBool (options.nonRealtime);
+        hello.writeInt ((int) options.state.getSize());
+        hello.write (options.state.getData(), options.state.getSize());
+
+        // an error comes with the hang-up straight after, so the reply is what counts here
+        if (! sendMessage (hello.getMemoryBlock()) || ! replied.wait (timeoutMs) || ! answered)
+        {
+            disconnect();
+            closeRing();
+            return Result::fail ("The server didn't answer");
+        }
+
+        if (! accepted)
+        {
+            disconnect();
+            closeRing();
+            return Result::fail (replyText);
+        }
+
+        // the server's ring, in the format we asked for
+        if (! ring.open (File (replyText))
+             || ring.getNumChannels() != options.numChannels || ring.getMaxBlockSize() != options.maxBlockSize
+             || ring.getNumSlots() != options.numSlots || ring.getSampleRate() != options.sampleRate)
+        {
+            disconnect();
+            closeRing();
+            return Result::fail ("Can't map the server's ring from " + replyText);
+        }
+
+        return Result::ok();
+    }
+
+    bool isReady() const noexcept           { return ring.isOpen() && accepted && ! lost.load(); }
+
+    int getNumChannels() const noexcept     { return ring.getNumChannels(); }
+    int getMaxBlockSize() const noexcept    { return ring.getMaxBlockSize(); }
+    int getNumSlots() const noexcept        { return ring.getNumSlots(); }
+    int getNumBlocksInFlight() const noexcept   { return (int) (numSubmitted - numCollected); }
+
+    //==============================================================================
+    /** The next free slot's channels, straight into shared memory, or nullptr if
+        they're all in flight and one has to be collected first.
+    */
+    float* const* getNextBlock() noexcept
+    {
+        if (! isReady() || getNumBlocksInFlight() >= getNumSlots())
+            return nullptr;
+
+        for (int channel = 0; channel < getNumChannels(); ++channel)
+            channelPointers[channel] = ring.getChannel (nextToFill, channel);
+
+        return channelPointers;
+    }
+
+    /** Sends the slot from getNextBlock() off to be processed. */
+    bool submitBlock (int numSamples)
+    {
+        jassert (isPositiveAndNotGreaterThan (numSamples, getMaxBlockSize()));
+
+        if (! isReady() || getNumBlocksInFlight() >= getNumSlots())
+            return false;
+
+        MemoryOutputStream message;
+        message.writeInt (SharedAudioRing::process);
+        message.writeInt (nextToFill);
+        message.writeInt (numSamples);
+
+        if (! sendMessage (message.getMemoryBlock()))
+            return false;
+
+        blockSizes[(size_t) nextToFill] = numSamples;
+        nextToFill = (nextToFill + 1) % getNumSlots();
+        ++numSubmitted;
+        return true;
+    }
+
+    /** Waits for the oldest block in flight and returns its processed channels,
+        or nullptr if nothing is in flight, the wait timed out or the server went away.
+    */
+    const float* const* waitForProcessedBlock (int& numSamples, int timeoutMs = -1)
+    {
+        numSamples = 0;
+
+        if (getNumBlocksInFlight() == 0)
+            return nullptr;
+
+        auto startTime = Time::getMillisecondCounter();
+
+        while (numDone.load() <= numCollected)
+        {
+            if (lost.load())
+                return nullptr;
+
+            auto waitMs = -1;
+
+            if (timeoutMs >= 0)
+            {
+                waitMs = timeoutMs - (int) (Time::getMillisecondCounter() - startTime);
+
+                if (waitMs <= 0)
+                    return nullptr;
+            }
+
+            blockDone.wait (waitMs);
+        }
+
+        for (int channel = 0; channel < getNumChannels(); ++channel)
+            channelPointers[channel] = ring.getChannel (nextToCollect, channel);
+
+        numSamples = blockSizes[(size_t) nextToCollect];
+        nextToCollect = (nextToCollect + 1) % getNumSlots();
+        ++numCollected;
+        return channelPointers;
+    }
+
+    /** One buffer through the processor and back, a slot at a time. */
+    bool process (AudioBuffer<float>& buffer, int timeoutMs = 5000)
+    {
+        if (! isReady())
+            return false;
+
+        auto numChannels = jmin (buffer.getNumChannels(), getNumChannels());
+        int numProcessed;
+
+        // anything still out from the streaming calls comes back first, or the order gets muddled
+        while (getNumBlocksInFlight() > 0)
+            if (waitForProcessedBlock (numProcessed, timeoutMs) == nullptr)
+                return false;
+
+        for (int done = 0; done < buffer.getNumSamples();)
+        {
+            auto numThisTime = jmin (getMaxBlockSize(), buffer.getNumSamples() - done);
+            auto* channels = getNextBlock();
+
+            if (channels == nullptr)
+                return false;
+
+            for (int channel = 0; channel < getNumChannels(); ++channel)
+            {
+                if (channel < numChannels)
+                    FloatVectorOperations::copy (channels[channel], buffer.getReadPointer (channel, done), numThisTime);
+                else
+                    FloatVectorOperations::clear (channels[channel], numThisTime);
+            }
+
+            if (! submitBlock (numThisTime))
+                return false;
+
+            auto* processed = waitForProcessedBlock (numProcessed, timeoutMs);
+
+            if (processed == nullptr)
+                return false;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                FloatVectorOperations::copy (buffer.getWritePointer (channel, done), processed[channel], numProcessed);
+
+            done += numThisTime;
+        }
+
+        return true;
+    }
+
+private:
+    //==============================================================================
+    SharedAudioRing ring;
+    float* channelPointers[SharedAudioRing::maxChannels] = {};
+    std::array<int, SharedAudioRing::maxSlots> blockSizes {};
+    int nextToFill = 0, nextToCollect = 0;
+    int64 numSubmitted = 0, numCollected = 0;
+
+    std::atomic<int64> numDone { 0 };
+    std::atomic<bool> lost { false };
+    WaitableEvent blockDone, replied;
+    bool accepted = false, answered = false;
+    String replyText;       // the reason for an error, or where to map the ring from
+
+    void closeRing()
+    {
+        ring.close();
+        accepted = false;
+    }
+
+    // these arrive on the connection's own thread
+    void connectionMade() override {}
+
+    void connectionLost() override
+    {
+        lost.store (true);
+        replied.signal();
+        blockDone.signal();
+    }
+
+    void messageReceived (const MemoryBlock& message) override
+    {
+        MemoryInputStream in (message, false);
+        auto type = in.readInt();
+
+        if ((type == SharedAudioRing::ready || type == SharedAudioRing::error) && ! answered)
+        {
+            answered = true;
+            accepted = type == SharedAudioRing::ready;
+            replyText = in.readString();
+            replied.signal();
+        }
+        else if (type == SharedAudioRing::error)
+        {
+            // we asked for something the ring doesn't have, and the server is hanging up
+            lost.store (true);
+            blockDone.signal();
+        }
+        else if (type == SharedAudioRing::done)
+        {
+            // the server answers in order, so counting them is enough
+            numDone.fetch_add (1);
+            blockDone.signal();
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DSPClient)
+};
@@ -0,0 +1,1024 @@
+/*
+  ==============================================================================
+
+    DSPKernels.h
+
+    The hot per-sample loops of the processor (biquad, gain ramp, peak scan,
+    hard clip, band split, compressor detector and gain, and the clipper's
+    antiderivatives), built for several instruction sets and picked at
+    runtime.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+// GCC and Clang need each function told which instruction set it may use.
+// MSVC lets any function use any intrinsic, so there this expands to nothing.
+#if JUCE_INTEL && (defined (__GNUC__) || defined (__clang__))
+ #define DSPKERNELS_TARGET(isa) __attribute__ ((target (isa)))
+#else
+ #define DSPKERNELS_TARGET(isa)
+#endif
+
+namespace DSPKernels
+{
+
+//==============================================================================
+/** Transposed direct form II biquad, the same structure IIRFilter uses.
+    coefficients are { b0, b1, b2, a1, a2 } normalised by a0, state is { z1, z2 }.
+*/
+using BiquadFunction    = void  (*) (float* data, int numSamples, const float* coefficients, float* state) noexcept;
+
+/** Multiplies data[i] by startGain + i * increment. */
+using GainRampFunction  = void  (*) (float* data, int numSamples, float startGain, float increment) noexcept;
+
+/** Returns the largest absolute sample value. */
+using PeakFunction      = float (*) (const float* data, int numSamples) noexcept;
+
+/** Limits every sample to [-limit, limit]. */
+using ClipFunction      = void  (*) (float* data, int numSamples, float limit) noexcept;
+
+/** A bank of biquad chains laid out for SIMD: lane l is band l / maxChannels
+    of channel l % maxChannels, and every lane runs the same number of
+    sections (unused ones are pass-throughs), so each section of every band
+    and channel is one vector operation per sample.
+*/
+struct BiquadLanes
+{
+    static constexpr int numLanes = 16;
+    static constexpr int maxChannels = 2;
+    static constexpr int maxSections = 8;
+
+    alignas (64) float b0[maxSections][numLanes];
+    alignas (64) float b1[maxSections][numLanes];
+    alignas (64) float b2[maxSections][numLanes];
+    alignas (64) float a1[maxSections][numLanes];
+    alignas (64) float a2[maxSections][numLanes];
+    alignas (64) float z1[maxSections][numLanes];
+    alignas (64) float z2[maxSections][numLanes];
+
+    // per lane, moving by increment every sample
+    alignas (64) float gain[numLanes];
+    alignas (64) float increment[numLanes];
+
+    int numSections;
+};
+
+/** Feeds each channel to its lanes, runs the chains, applies each lane's gain,
+    limits it to [-limit, limit] and sums the lanes back into their channels.
+*/
+using SplitBandsFunction = void (*) (BiquadLanes& lanes, float* const* channels, int numChannels,
+                                     int numSamples, float limit) noexcept;
+
+/** A compressor's static curve in log2 units, i.e. dB / 6.02. Above the
+    threshold by more than halfKnee, each unit of level over it gives slope
+    units of reduction; inside the knee the reduction eases in quadratically.
+    kneeScale is 1 / (4 * halfKnee), or 0 for a hard knee.
+*/
+struct GainCurve
+{
+    float threshold, halfKnee, kneeScale, slope;
+};
+
+/** Stereo-linked detection: takes the loudest channel at every sample and writes
+    the reduction the curve asks for there, in log2 units. Returns the largest.
+*/
+using GainReductionFunction = float (*) (const float* const* channels, int numChannels, float* reduction,
+                                         int numSamples, const GainCurve& curve) noexcept;
+
+/** Multiplies every channel by 2^gains[i]. */
+using LogGainFunction = void (*) (float* const* channels, int numChannels, const float* gains, int numSamples) noexcept;
+
+/** The clipper's two polynomial curves: hard (a plain clip to +-1) and cubic
+    (1.5x - 0.5x^3 up to +-1, flat beyond).
+*/
+enum class ClosedFormCurve
+{
+    hard,
+    cubic
+};
+
+/** The first (order 1) or second (order 2) antiderivative of a closed-form
+    curve, for the waveshaper's ADAA. Inside +-1 both are odd or even
+    polynomials; outside they carry on as a line and a parabola:
+
+        order 1   x^2 (p + q x^2)      |x| - c
+        order 2   x^3 (p + q x^2)      sign (x) (x^2 / 2 - c |x| + d)
+*/
+struct AntiderivativeCoefficients
+{
+    double p, q, c, d;
+
+    static AntiderivativeCoefficients of (ClosedFormCurve curve, int order) noexcept
+    {
+        if (curve == ClosedFormCurve::cubic)
+            return order == 1 ? AntiderivativeCoefficients { 0.75, -0.125, 0.375, 0.0 }
+                              : AntiderivativeCoefficients { 0.25, -0.025, 0.375, 0.1 };
+
+        return order == 1 ? AntiderivativeCoefficients { 0.5, 0.0, 0.5, 0.0 }
+                          : AntiderivativeCoefficients { 1.0 / 6.0, 0.0, 0.5, 1.0 / 6.0 };
+    }
+};
+
+/** One antiderivative at one point, for the waveshaper's fallbacks; the
+    kernels below give the same values a block at a time.
+*/
+forcedinline double closedFormAntiderivative (ClosedFormCurve curve, int order, double x) noexcept
+{
+    auto k = AntiderivativeCoefficients::of (curve, order);
+    auto a = std::abs (x);
+    auto x2 = x * x;
+
+    if (order == 1)
+        return a <= 1.0 ? x2 * (k.p + k.q * x2) : a - k.c;
+
+    return a <= 1.0 ? x2 * x * (k.p + k.q * x2) : std::copysign (0.5 * x2 - k.c * a + k.d, x);
+}
+
+/** Writes closedFormAntiderivative (curve, order, data[i]) to antiderivatives[i]. */
+using AntiderivativeFunction = void (*) (const float* data, double* antiderivatives, int numSamples,
+                                         ClosedFormCurve curve, int order) noexcept;
+
+struct KernelTable
+{
+    const char* name;
+    BiquadFunction biquad;
+    GainRampFunction gainRamp;
+    PeakFunction peak;
+    ClipFunction clip;
+    SplitBandsFunction splitBands;
+    GainReductionFunction gainReduction;
+    LogGainFunction logGain;
+    AntiderivativeFunction antiderivative;
+};
+
+enum class Variant
+{
+    automatic = 0,
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+//==============================================================================
+namespace detail
+{
+    // The biquad is recursive, so it can't be spread across lanes; each variant
+    // compiles this same loop for its own instruction set (FMA from AVX2 up).
+    forcedinline void biquad (float* data, int numSamples, const float* c, float* state) noexcept
+    {
+        auto b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        auto z1 = state[0], z2 = state[1];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto in  = data[i];
+            auto out = b0 * in + z1;
+
+            z1 = b1 * in - a1 * out + z2;
+            z2 = b2 * in - a2 * out;
+            data[i] = out;
+        }
+
+        // same denormal guard IIRFilter applies at the end of each block
+        state[0] = std::abs (z1) < 1.0e-8f ? 0.0f : z1;
+        state[1] = std::abs (z2) < 1.0e-8f ? 0.0f : z2;
+    }
+
+    // Unlike the biquad above this one recurses within each lane only, so the
+    // fixed-width lane loops vectorise in whatever instruction set it's built for.
+    // The mono instance broadcasts one input and only sums the left lanes.
+    template <bool stereo>
+    forcedinline void splitBands (BiquadLanes& lanes, float* const* channels,
+                                  int numSamples, float limit) noexcept
+    {
+        constexpr int numLanes = BiquadLanes::numLanes;
+        auto* left = channels[0];
+        auto* right = channels[stereo ? 1 : 0];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            alignas (64) float x[numLanes];
+
+            if (stereo)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                    x[l] = (l & 1) != 0 ? right[i] : left[i];
+            }
+            else
+            {
+                std::fill (x, x + numLanes, left[i]);
+            }
+
+            for (int s = 0; s < lanes.numSections; ++s)
+            {
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    auto in  = x[l];
+                    auto out = lanes.b0[s][l] * in + lanes.z1[s][l];
+
+                    lanes.z1[s][l] = lanes.b1[s][l] * in - lanes.a1[s][l] * out + lanes.z2[s][l];
+                    lanes.z2[s][l] = lanes.b2[s][l] * in - lanes.a2[s][l] * out;
+                    x[l] = out;
+                }
+            }
+
+            for (int l = 0; l < numLanes; ++l)
+            {
+                x[l] = jlimit (-limit, limit, x[l] * lanes.gain[l]);
+                lanes.gain[l] += lanes.increment[l];
+            }
+
+            auto leftSum = 0.0f, rightSum = 0.0f;
+
+            for (int l = 0; l < numLanes; l += 2)
+            {
+                leftSum += x[l];
+
+                if (stereo)
+                    rightSum += x[l + 1];
+            }
+
+            left[i] = leftSum;
+
+            if (stereo)
+                right[i] = rightSum;
+        }
+
+        for (int s = 0; s < lanes.numSections; ++s)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                lanes.z1[s][l] = std::abs (lanes.z1[s][l]) < 1.0e-8f ? 0.0f : lanes.z1[s][l];
+                lanes.z2[s][l] = std::abs (lanes.z2[s][l]) < 1.0e-8f ? 0.0f : lanes.z2[s][l];
+            }
+        }
+    }
+
+    forcedinline void gainRampScalar (float* data, int start, int end, float startGain, float increment) noexcept
+    {
+        for (int i = start; i < end; ++i)
+            data[i] *= startGain + (float) i * increment;
+    }
+
+    forcedinline float peakScalar (const float* data, int start, int end, float peak) noexcept
+    {
+        for (int i = start; i < end; ++i)
+            peak = jmax (peak, std::abs (data[i]));
+
+        return peak;
+    }
+
+    forcedinline void clipScalar (float* data, int start, int end, float limit) noexcept
+    {
+        for (int i = start; i < end; ++i)
+            data[i] = jlimit (-limit, limit, data[i]);
+    }
+
+    forcedinline void antiderivativeScalar (const float* data, double* antiderivatives, int start, int end,
+                                            ClosedFormCurve curve, int order) noexcept
+    {
+        for (int i = start; i < end; ++i)
+            antiderivatives[i] = closedFormAntiderivative (curve, order, (double) data[i]);
+    }
+
+    // The compressor's log2 and exp2 are cubics on the mantissa, pinned at both
+    // ends so they join up from one octave to the next. The log is within
+    // 0.006 dB and the exp within 0.002 dB, far finer than a gain computer needs.
+    // The detector floors its level at about -180 dB, which keeps the log away
+    // from zero and denormals.
+    static constexpr float log2Poly0 = 1.42285971f, log2Poly1 = -0.58207136f, log2Poly2 = 0.15921165f;
+    static constexpr float exp2Poly0 = 0.69589020f, exp2Poly1 = 0.22486522f, exp2Poly2 = 0.07924458f;
+    static constexpr float minDetectorLevel = 1.0e-9f;
+
+    forcedinline float approxLog2 (float x) noexcept
+    {
+        int32 bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        auto exponent = (float) ((bits >> 23) - 127);
+        bits = (bits & 0x007fffff) | 0x3f800000;
+
+        float mantissa;
+        std::memcpy (&mantissa, &bits, sizeof (mantissa));
+
+        auto t = mantissa - 1.0f;
+        return exponent + t * (log2Poly0 + t * (log2Poly1 + t * log2Poly2));
+    }
+
+    forcedinline float approxExp2 (float x) noexcept
+    {
+        x = jlimit (-126.0f, 126.0f, x);
+
+        auto whole = std::floor (x);
+        auto t = x - whole;
+        auto bits = ((int32) whole + 127) << 23;
+
+        float scale;
+        std::memcpy (&scale, &bits, sizeof (scale));
+
+        return scale * (1.0f + t * (exp2Poly0 + t * (exp2Poly1 + t * exp2Poly2)));
+    }
+
+    forcedinline float gainReductionScalar (const float* const* channels, int numChannels, float* reduction,
+                                            int start, int end, const GainCurve& curve, float largest) noexcept
+    {
+        for (int i = start; i < end; ++i)
+        {
+            auto level = minDetectorLevel;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                level = jmax (level, std::abs (channels[channel][i]));
+
+            auto over = approxLog2 (level) - curve.threshold;
+            auto knee = jlimit (0.0f, 2.0f * curve.halfKnee, over + curve.halfKnee);
+
+            reduction[i] = curve.slope * (knee * knee * curve.kneeScale + jmax (0.0f, over - curve.halfKnee));
+            largest = jmax (largest, reduction[i]);
+        }
+
+        return largest;
+    }
+
+    forcedinline void logGainScalar (float* const* channels, int numChannels, const float* gains, int start, int end) noexcept
+    {
+        for (int i = start; i < end; ++i)
+        {
+            auto gain = approxExp2 (gains[i]);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[channel][i] *= gain;
+        }
+    }
+
+    //==============================================================================
+    namespace scalar
+    {
+        inline void biquad (float* data, int numSamples, const float* c, float* state) noexcept
+        {
+            detail::biquad (data, numSamples, c, state);
+        }
+
+        inline void gainRamp (float* data, int numSamples, float startGain, float increment) noexcept
+        {
+            gainRampScalar (data, 0, numSamples, startGain, increment);
+        }
+
+        inline float peak (const float* data, int numSamples) noexcept
+        {
+            return peakScalar (data, 0, numSamples, 0.0f);
+        }
+
+        inline void clip (float* data, int numSamples, float limit) noexcept
+        {
+            clipScalar (data, 0, numSamples, limit);
+        }
+
+        inline void splitBands (BiquadLanes& lanes, float* const* channels, int numChannels, int numSamples, float limit) noexcept
+        {
+            if (numChannels > 1)
+                detail::splitBands<true> (lanes, channels, numSamples, limit);
+            else
+                detail::splitBands<false> (lanes, channels, numSamples, limit);
+        }
+
+        inline float gainReduction (const float* const* channels, int numChannels, float* reduction,
+                                    int numSamples, const GainCurve& curve) noexcept
+        {
+            return gainReductionScalar (channels, numChannels, reduction, 0, numSamples, curve, 0.0f);
+        }
+
+        inline void logGain (float* const* channels, int numChannels, const float* gains, int numSamples) noexcept
+        {
+            logGainScalar (channels, numChannels, gains, 0, numSamples);
+        }
+
+        inline void antiderivative (const float* data, double* antiderivatives, int numSamples,
+                                    ClosedFormCurve curve, int order) noexcept
+        {
+            antiderivativeScalar (data, antiderivatives, 0, numSamples, curve, order);
+        }
+    }
+
+   #if JUCE_INTEL
+    //==============================================================================
+    namespace sse2
+    {
+        DSPKERNELS_TARGET ("sse2")
+        inline void biquad (float* data, int numSamples, const float* c, float* state) noexcept
+        {
+            detail::biquad (data, numSamples, c, state);
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline void gainRamp (float* data, int numSamples, float startGain, float increment) noexcept
+        {
+            auto gain = _mm_add_ps (_mm_set1_ps (startGain), _mm_mul_ps (_mm_set_ps (3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps (increment)));
+            auto step = _mm_set1_ps (4.0f * increment);
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), gain));
+                gain = _mm_add_ps (gain, step);
+            }
+
+            gainRampScalar (data, i, numSamples, startGain, increment);
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline float peak (const float* data, int numSamples) noexcept
+        {
+            auto absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+            auto peak = _mm_setzero_ps();
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+                peak = _mm_max_ps (peak, _mm_and_ps (_mm_loadu_ps (data + i), absMask));
+
+            peak = _mm_max_ps (peak, _mm_shuffle_ps (peak, peak, _MM_SHUFFLE (1, 0, 3, 2)));
+            peak = _mm_max_ps (peak, _mm_shuffle_ps (peak, peak, _MM_SHUFFLE (2, 3, 0, 1)));
+
+            return peakScalar (data, i, numSamples, _mm_cvtss_f32 (peak));
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline void clip (float* data, int numSamples, float limit) noexcept
+        {
+            auto high = _mm_set1_ps (limit), low = _mm_set1_ps (-limit);
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+                _mm_storeu_ps (data + i, _mm_min_ps (high, _mm_max_ps (low, _mm_loadu_ps (data + i))));
+
+            clipScalar (data, i, numSamples, limit);
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline void splitBands (BiquadLanes& lanes, float* const* channels, int numChannels, int numSamples, float limit) noexcept
+        {
+            if (numChannels > 1)
+                detail::splitBands<true> (lanes, channels, numSamples, limit);
+            else
+                detail::splitBands<false> (lanes, channels, numSamples, limit);
+        }
+
+        // the same cubics as approxLog2 and approxExp2, four at a time
+        DSPKERNELS_TARGET ("sse2")
+        inline __m128 approxLog2 (__m128 x) noexcept
+        {
+            auto bits = _mm_castps_si128 (x);
+            auto exponent = _mm_cvtepi32_ps (_mm_sub_epi32 (_mm_srli_epi32 (bits, 23), _mm_set1_epi32 (127)));
+            auto mantissa = _mm_castsi128_ps (_mm_or_si128 (_mm_and_si128 (bits, _mm_set1_epi32 (0x007fffff)), _mm_set1_epi32 (0x3f800000)));
+            auto t = _mm_sub_ps (mantissa, _mm_set1_ps (1.0f));
+
+            auto poly = _mm_add_ps (_mm_set1_ps (log2Poly1), _mm_mul_ps (t, _mm_set1_ps (log2Poly2)));
+            poly = _mm_add_ps (_mm_set1_ps (log2Poly0), _mm_mul_ps (t, poly));
+            return _mm_add_ps (exponent, _mm_mul_ps (t, poly));
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline __m128 approxExp2 (__m128 x) noexcept
+        {
+            x = _mm_min_ps (_mm_set1_ps (126.0f), _mm_max_ps (_mm_set1_ps (-126.0f), x));
+
+            // SSE2 has no floor: truncate, then step back the ones that went up
+            auto whole = _mm_cvttps_epi32 (x);
+            auto above = _mm_cmpgt_ps (_mm_cvtepi32_ps (whole), x);
+            whole = _mm_add_epi32 (whole, _mm_castps_si128 (above));
+
+            auto t = _mm_sub_ps (x, _mm_cvtepi32_ps (whole));
+            auto scale = _mm_castsi128_ps (_mm_slli_epi32 (_mm_add_epi32 (whole, _mm_set1_epi32 (127)), 23));
+
+            auto poly = _mm_add_ps (_mm_set1_ps (exp2Poly1), _mm_mul_ps (t, _mm_set1_ps (exp2Poly2)));
+            poly = _mm_add_ps (_mm_set1_ps (exp2Poly0), _mm_mul_ps (t, poly));
+            return _mm_mul_ps (scale, _mm_add_ps (_mm_set1_ps (1.0f), _mm_mul_ps (t, poly)));
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline float gainReduction (const float* const* channels, int numChannels, float* reduction,
+                                    int numSamples, const GainCurve& curve) noexcept
+        {
+            auto absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+            auto threshold = _mm_set1_ps (curve.threshold), halfKnee = _mm_set1_ps (curve.halfKnee);
+            auto kneeWidth = _mm_set1_ps (2.0f * curve.halfKnee), kneeScale = _mm_set1_ps (curve.kneeScale);
+            auto slope = _mm_set1_ps (curve.slope), zero = _mm_setzero_ps();
+            auto largest = zero;
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto level = _mm_set1_ps (minDetectorLevel);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    level = _mm_max_ps (level, _mm_and_ps (_mm_loadu_ps (channels[channel] + i), absMask));
+
+                auto over = _mm_sub_ps (approxLog2 (level), threshold);
+                auto knee = _mm_min_ps (kneeWidth, _mm_max_ps (zero, _mm_add_ps (over, halfKnee)));
+                auto result = _mm_add_ps (_mm_mul_ps (_mm_mul_ps (knee, knee), kneeScale), _mm_max_ps (zero, _mm_sub_ps (over, halfKnee)));
+
+                result = _mm_mul_ps (slope, result);
+                _mm_storeu_ps (reduction + i, result);
+                largest = _mm_max_ps (largest, result);
+            }
+
+            largest = _mm_max_ps (largest, _mm_shuffle_ps (largest, largest, _MM_SHUFFLE (1, 0, 3, 2)));
+            largest = _mm_max_ps (largest, _mm_shuffle_ps (largest, largest, _MM_SHUFFLE (2, 3, 0, 1)));
+
+            return gainReductionScalar (channels, numChannels, reduction, i, numSamples, curve, _mm_cvtss_f32 (largest));
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline void logGain (float* const* channels, int numChannels, const float* gains, int numSamples) noexcept
+        {
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto gain = approxExp2 (_mm_loadu_ps (gains + i));
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    _mm_storeu_ps (channels[channel] + i, _mm_mul_ps (_mm_loadu_ps (channels[channel] + i), gain));
+            }
+
+            logGainScalar (channels, numChannels, gains, i, numSamples);
+        }
+
+        // in double, two at a time; both sides of +-1 are worked out and the mask picks one
+        DSPKERNELS_TARGET ("sse2")
+        inline __m128d antiderivative (__m128d x, const AntiderivativeCoefficients& k, int order) noexcept
+        {
+            auto signMask = _mm_set1_pd (-0.0);
+            auto a = _mm_andnot_pd (signMask, x);
+            auto x2 = _mm_mul_pd (x, x);
+            auto inside = _mm_cmple_pd (a, _mm_set1_pd (1.0));
+            auto poly = _mm_mul_pd (x2, _mm_add_pd (_mm_set1_pd (k.p), _mm_mul_pd (_mm_set1_pd (k.q), x2)));
+            __m128d outside;
+
+            if (order == 1)
+            {
+                outside = _mm_sub_pd (a, _mm_set1_pd (k.c));
+            }
+            else
+            {
+                poly = _mm_mul_pd (poly, x);
+                outside = _mm_add_pd (_mm_sub_pd (_mm_mul_pd (_mm_set1_pd (0.5), x2), _mm_mul_pd (_mm_set1_pd (k.c), a)), _mm_set1_pd (k.d));
+                outside = _mm_or_pd (_mm_andnot_pd (signMask, outside), _mm_and_pd (signMask, x));
+            }
+
+            return _mm_or_pd (_mm_and_pd (inside, poly), _mm_andnot_pd (inside, outside));
+        }
+
+        DSPKERNELS_TARGET ("sse2")
+        inline void antiderivative (const float* data, double* antiderivatives, int numSamples,
+                                    ClosedFormCurve curve, int order) noexcept
+        {
+            auto k = AntiderivativeCoefficients::of (curve, order);
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                auto x = _mm_loadu_ps (data + i);
+                _mm_storeu_pd (antiderivatives + i,     antiderivative (_mm_cvtps_pd (x), k, order));
+                _mm_storeu_pd (antiderivatives + i + 2, antiderivative (_mm_cvtps_pd (_mm_movehl_ps (x, x)), k, order));
+            }
+
+            antiderivativeScalar (data, antiderivatives, i, numSamples, curve, order);
+        }
+    }
+
+    //==============================================================================
+    namespace avx2
+    {
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void biquad (float* data, int numSamples, const float* c, float* state) noexcept
+        {
+            detail::biquad (data, numSamples, c, state);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void gainRamp (float* data, int numSamples, float startGain, float increment) noexcept
+        {
+            auto gain = _mm256_fmadd_ps (_mm256_set_ps (7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f),
+                                         _mm256_set1_ps (increment), _mm256_set1_ps (startGain));
+            auto step = _mm256_set1_ps (8.0f * increment);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                _mm256_storeu_ps (data + i, _mm256_mul_ps (_mm256_loadu_ps (data + i), gain));
+                gain = _mm256_add_ps (gain, step);
+            }
+
+            gainRampScalar (data, i, numSamples, startGain, increment);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline float peak (const float* data, int numSamples) noexcept
+        {
+            auto absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7fffffff));
+            auto peak = _mm256_setzero_ps();
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+                peak = _mm256_max_ps (peak, _mm256_and_ps (_mm256_loadu_ps (data + i), absMask));
+
+            auto half = _mm_max_ps (_mm256_castps256_ps128 (peak), _mm256_extractf128_ps (peak, 1));
+            half = _mm_max_ps (half, _mm_shuffle_ps (half, half, _MM_SHUFFLE (1, 0, 3, 2)));
+            half = _mm_max_ps (half, _mm_shuffle_ps (half, half, _MM_SHUFFLE (2, 3, 0, 1)));
+
+            return peakScalar (data, i, numSamples, _mm_cvtss_f32 (half));
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void clip (float* data, int numSamples, float limit) noexcept
+        {
+            auto high = _mm256_set1_ps (limit), low = _mm256_set1_ps (-limit);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+                _mm256_storeu_ps (data + i, _mm256_min_ps (high, _mm256_max_ps (low, _mm256_loadu_ps (data + i))));
+
+            clipScalar (data, i, numSamples, limit);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void splitBands (BiquadLanes& lanes, float* const* channels, int numChannels, int numSamples, float limit) noexcept
+        {
+            if (numChannels > 1)
+                detail::splitBands<true> (lanes, channels, numSamples, limit);
+            else
+                detail::splitBands<false> (lanes, channels, numSamples, limit);
+        }
+
+        // the same cubics as approxLog2 and approxExp2, eight at a time
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline __m256 approxLog2 (__m256 x) noexcept
+        {
+            auto bits = _mm256_castps_si256 (x);
+            auto exponent = _mm256_cvtepi32_ps (_mm256_sub_epi32 (_mm256_srli_epi32 (bits, 23), _mm256_set1_epi32 (127)));
+            auto mantissa = _mm256_castsi256_ps (_mm256_or_si256 (_mm256_and_si256 (bits, _mm256_set1_epi32 (0x007fffff)), _mm256_set1_epi32 (0x3f800000)));
+            auto t = _mm256_sub_ps (mantissa, _mm256_set1_ps (1.0f));
+
+            auto poly = _mm256_fmadd_ps (t, _mm256_set1_ps (log2Poly2), _mm256_set1_ps (log2Poly1));
+            poly = _mm256_fmadd_ps (t, poly, _mm256_set1_ps (log2Poly0));
+            return _mm256_fmadd_ps (t, poly, exponent);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline __m256 approxExp2 (__m256 x) noexcept
+        {
+            x = _mm256_min_ps (_mm256_set1_ps (126.0f), _mm256_max_ps (_mm256_set1_ps (-126.0f), x));
+
+            auto whole = _mm256_floor_ps (x);
+            auto t = _mm256_sub_ps (x, whole);
+            auto scale = _mm256_castsi256_ps (_mm256_slli_epi32 (_mm256_add_epi32 (_mm256_cvtps_epi32 (whole), _mm256_set1_epi32 (127)), 23));
+
+            auto poly = _mm256_fmadd_ps (t, _mm256_set1_ps (exp2Poly2), _mm256_set1_ps (exp2Poly1));
+            poly = _mm256_fmadd_ps (t, poly, _mm256_set1_ps (exp2Poly0));
+            return _mm256_mul_ps (scale, _mm256_fmadd_ps (t, poly, _mm256_set1_ps (1.0f)));
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline float gainReduction (const float* const* channels, int numChannels, float* reduction,
+                                    int numSamples, const GainCurve& curve) noexcept
+        {
+            auto absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7fffffff));
+            auto threshold = _mm256_set1_ps (curve.threshold), halfKnee = _mm256_set1_ps (curve.halfKnee);
+            auto kneeWidth = _mm256_set1_ps (2.0f * curve.halfKnee), kneeScale = _mm256_set1_ps (curve.kneeScale);
+            auto slope = _mm256_set1_ps (curve.slope), zero = _mm256_setzero_ps();
+            auto largest = zero;
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                auto level = _mm256_set1_ps (minDetectorLevel);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    level = _mm256_max_ps (level, _mm256_and_ps (_mm256_loadu_ps (channels[channel] + i), absMask));
+
+                auto over = _mm256_sub_ps (approxLog2 (level), threshold);
+                auto knee = _mm256_min_ps (kneeWidth, _mm256_max_ps (zero, _mm256_add_ps (over, halfKnee)));
+                auto result = _mm256_fmadd_ps (_mm256_mul_ps (knee, knee), kneeScale, _mm256_max_ps (zero, _mm256_sub_ps (over, halfKnee)));
+
+                result = _mm256_mul_ps (slope, result);
+                _mm256_storeu_ps (reduction + i, result);
+                largest = _mm256_max_ps (largest, result);
+            }
+
+            auto half = _mm_max_ps (_mm256_castps256_ps128 (largest), _mm256_extractf128_ps (largest, 1));
+            half = _mm_max_ps (half, _mm_shuffle_ps (half, half, _MM_SHUFFLE (1, 0, 3, 2)));
+            half = _mm_max_ps (half, _mm_shuffle_ps (half, half, _MM_SHUFFLE (2, 3, 0, 1)));
+
+            return gainReductionScalar (channels, numChannels, reduction, i, numSamples, curve, _mm_cvtss_f32 (half));
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void logGain (float* const* channels, int numChannels, const float* gains, int numSamples) noexcept
+        {
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                auto gain = approxExp2 (_mm256_loadu_ps (gains + i));
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    _mm256_storeu_ps (channels[channel] + i, _mm256_mul_ps (_mm256_loadu_ps (channels[channel] + i), gain));
+            }
+
+            logGainScalar (channels, numChannels, gains, i, numSamples);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline __m256d antiderivative (__m256d x, const AntiderivativeCoefficients& k, int order) noexcept
+        {
+            auto signMask = _mm256_set1_pd (-0.0);
+            auto a = _mm256_andnot_pd (signMask, x);
+            auto x2 = _mm256_mul_pd (x, x);
+            auto inside = _mm256_cmp_pd (a, _mm256_set1_pd (1.0), _CMP_LE_OQ);
+            auto poly = _mm256_mul_pd (x2, _mm256_fmadd_pd (_mm256_set1_pd (k.q), x2, _mm256_set1_pd (k.p)));
+            __m256d outside;
+
+            if (order == 1)
+            {
+                outside = _mm256_sub_pd (a, _mm256_set1_pd (k.c));
+            }
+            else
+            {
+                poly = _mm256_mul_pd (poly, x);
+                outside = _mm256_fmadd_pd (_mm256_set1_pd (0.5), x2, _mm256_fnmadd_pd (_mm256_set1_pd (k.c), a, _mm256_set1_pd (k.d)));
+                outside = _mm256_or_pd (_mm256_andnot_pd (signMask, outside), _mm256_and_pd (signMask, x));
+            }
+
+            return _mm256_blendv_pd (outside, poly, inside);
+        }
+
+        DSPKERNELS_TARGET ("avx2,fma")
+        inline void antiderivative (const float* data, double* antiderivatives, int numSamples,
+                                    ClosedFormCurve curve, int order) noexcept
+        {
+            auto k = AntiderivativeCoefficients::of (curve, order);
+            int i = 0;
+
+            for (; i + 4 <= numSamples; i += 4)
+                _mm256_storeu_pd (antiderivatives + i, antiderivative (_mm256_cvtps_pd (_mm_loadu_ps (data + i)), k, order));
+
+            antiderivativeScalar (data, antiderivatives, i, numSamples, curve, order);
+        }
+    }
+
+    //==============================================================================
+    namespace avx512
+    {
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void biquad (float* data, int numSamples, const float* c, float* state) noexcept
+        {
+            detail::biquad (data, numSamples, c, state);
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void gainRamp (float* data, int numSamples, float startGain, float increment) noexcept
+        {
+            auto gain = _mm512_fmadd_ps (_mm512_set_ps (15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+                                                        7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f),
+                                         _mm512_set1_ps (increment), _mm512_set1_ps (startGain));
+            auto step = _mm512_set1_ps (16.0f * increment);
+            int i = 0;
+
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                _mm512_storeu_ps (data + i, _mm512_mul_ps (_mm512_loadu_ps (data + i), gain));
+                gain = _mm512_add_ps (gain, step);
+            }
+
+            gainRampScalar (data, i, numSamples, startGain, increment);
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline float peak (const float* data, int numSamples) noexcept
+        {
+            auto peak = _mm512_setzero_ps();
+            int i = 0;
+
+            for (; i + 16 <= numSamples; i += 16)
+                peak = _mm512_max_ps (peak, _mm512_abs_ps (_mm512_loadu_ps (data + i)));
+
+            return peakScalar (data, i, numSamples, _mm512_reduce_max_ps (peak));
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void clip (float* data, int numSamples, float limit) noexcept
+        {
+            auto high = _mm512_set1_ps (limit), low = _mm512_set1_ps (-limit);
+            int i = 0;
+
+            for (; i + 16 <= numSamples; i += 16)
+                _mm512_storeu_ps (data + i, _mm512_min_ps (high, _mm512_max_ps (low, _mm512_loadu_ps (data + i))));
+
+            clipScalar (data, i, numSamples, limit);
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void splitBands (BiquadLanes& lanes, float* const* channels, int numChannels, int numSamples, float limit) noexcept
+        {
+            if (numChannels > 1)
+                detail::splitBands<true> (lanes, channels, numSamples, limit);
+            else
+                detail::splitBands<false> (lanes, channels, numSamples, limit);
+        }
+
+        // the same cubics as approxLog2 and approxExp2, sixteen at a time
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline __m512 approxLog2 (__m512 x) noexcept
+        {
+            auto bits = _mm512_castps_si512 (x);
+            auto exponent = _mm512_cvtepi32_ps (_mm512_sub_epi32 (_mm512_srli_epi32 (bits, 23), _mm512_set1_epi32 (127)));
+            auto mantissa = _mm512_castsi512_ps (_mm512_or_si512 (_mm512_and_si512 (bits, _mm512_set1_epi32 (0x007fffff)), _mm512_set1_epi32 (0x3f800000)));
+            auto t = _mm512_sub_ps (mantissa, _mm512_set1_ps (1.0f));
+
+            auto poly = _mm512_fmadd_ps (t, _mm512_set1_ps (log2Poly2), _mm512_set1_ps (log2Poly1));
+            poly = _mm512_fmadd_ps (t, poly, _mm512_set1_ps (log2Poly0));
+            return _mm512_fmadd_ps (t, poly, exponent);
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline __m512 approxExp2 (__m512 x) noexcept
+        {
+            x = _mm512_min_ps (_mm512_set1_ps (126.0f), _mm512_max_ps (_mm512_set1_ps (-126.0f), x));
+
+            auto whole = _mm512_roundscale_ps (x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            auto t = _mm512_sub_ps (x, whole);
+            auto scale = _mm512_castsi512_ps (_mm512_slli_epi32 (_mm512_add_epi32 (_mm512_cvtps_epi32 (whole), _mm512_set1_epi32 (127)), 23));
+
+            auto poly = _mm512_fmadd_ps (t, _mm512_set1_ps (exp2Poly2), _mm512_set1_ps (exp2Poly1));
+            poly = _mm512_fmadd_ps (t, poly, _mm512_set1_ps (exp2Poly0));
+            return _mm512_mul_ps (scale, _mm512_fmadd_ps (t, poly, _mm512_set1_ps (1.0f)));
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline float gainReduction (const float* const* channels, int numChannels, float* reduction,
+                                    int numSamples, const GainCurve& curve) noexcept
+        {
+            auto threshold = _mm512_set1_ps (curve.threshold), halfKnee = _mm512_set1_ps (curve.halfKnee);
+            auto kneeWidth = _mm512_set1_ps (2.0f * curve.halfKnee), kneeScale = _mm512_set1_ps (curve.kneeScale);
+            auto slope = _mm512_set1_ps (curve.slope), zero = _mm512_setzero_ps();
+            auto largest = zero;
+            int i = 0;
+
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                auto level = _mm512_set1_ps (minDetectorLevel);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    level = _mm512_max_ps (level, _mm512_abs_ps (_mm512_loadu_ps (channels[channel] + i)));
+
+                auto over = _mm512_sub_ps (approxLog2 (level), threshold);
+                auto knee = _mm512_min_ps (kneeWidth, _mm512_max_ps (zero, _mm512_add_ps (over, halfKnee)));
+                auto result = _mm512_fmadd_ps (_mm512_mul_ps (knee, knee), kneeScale, _mm512_max_ps (zero, _mm512_sub_ps (over, halfKnee)));
+
+                result = _mm512_mul_ps (slope, result);
+                _mm512_storeu_ps (reduction + i, result);
+                largest = _mm512_max_ps (largest, result);
+            }
+
+            return gainReductionScalar (channels, numChannels, reduction, i, numSamples, curve, _mm512_reduce_max_ps (largest));
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void logGain (float* const* channels, int numChannels, const float* gains, int numSamples) noexcept
+        {
+            int i = 0;
+
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                auto gain = approxExp2 (_mm512_loadu_ps (gains + i));
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    _mm512_storeu_ps (channels[channel] + i, _mm512_mul_ps (_mm512_loadu_ps (channels[channel] + i), gain));
+            }
+
+            logGainScalar (channels, numChannels, gains, i, numSamples);
+        }
+
+        // AVX-512F has no and/or on doubles (that's DQ), so the sign goes through the integer side
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline __m512d antiderivative (__m512d x, const AntiderivativeCoefficients& k, int order) noexcept
+        {
+            auto a = _mm512_abs_pd (x);
+            auto x2 = _mm512_mul_pd (x, x);
+            auto inside = _mm512_cmp_pd_mask (a, _mm512_set1_pd (1.0), _CMP_LE_OQ);
+            auto poly = _mm512_mul_pd (x2, _mm512_fmadd_pd (_mm512_set1_pd (k.q), x2, _mm512_set1_pd (k.p)));
+            __m512d outside;
+
+            if (order == 1)
+            {
+                outside = _mm512_sub_pd (a, _mm512_set1_pd (k.c));
+            }
+            else
+            {
+                auto signMask = _mm512_set1_epi64 ((long long) 0x8000000000000000ull);
+                poly = _mm512_mul_pd (poly, x);
+                outside = _mm512_fmadd_pd (_mm512_set1_pd (0.5), x2, _mm512_fnmadd_pd (_mm512_set1_pd (k.c), a, _mm512_set1_pd (k.d)));
+                outside = _mm512_castsi512_pd (_mm512_or_si512 (_mm512_andnot_si512 (signMask, _mm512_castpd_si512 (outside)),
+                                                                _mm512_and_si512 (signMask, _mm512_castpd_si512 (x))));
+            }
+
+            return _mm512_mask_blend_pd (inside, outside, poly);
+        }
+
+        DSPKERNELS_TARGET ("avx512f,fma")
+        inline void antiderivative (const float* data, double* antiderivatives, int numSamples,
+                                    ClosedFormCurve curve, int order) noexcept
+        {
+            auto k = AntiderivativeCoefficients::of (curve, order);
+            int i = 0;
+
+            for (; i + 8 <= numSamples; i += 8)
+                _mm512_storeu_pd (antiderivatives + i, antiderivative (_mm512_cvtps_pd (_mm256_loadu_ps (data + i)), k, order));
+
+            antiderivativeScalar (data, antiderivatives, i, numSamples, curve, order);
+        }
+    }
+   #endif
+}
+
+//==============================================================================
+/** Returns the kernels for a variant. Asking for one the CPU can't run gives
+    the best one it can, so a forced variant never crashes an older machine.
+*/
+inline const KernelTable& getKernels (Variant variant) noexcept
+{
+    static const KernelTable scalarTable { "Scalar", detail::scalar::biquad, detail::scalar::gainRamp,
+                                           detail::scalar::peak, detail::scalar::clip, detail::scalar::splitBands,
+                                           detail::scalar::gainReduction, detail::scalar::logGain,
+                                           detail::scalar::antiderivative };
+
+    if (variant == Variant::scalar)
+        return scalarTable;
+
+   #if JUCE_INTEL
+    static const KernelTable sse2Table   { "SSE2", detail::sse2::biquad, detail::sse2::gainRamp,
+                                           detail::sse2::peak, detail::sse2::clip, detail::sse2::splitBands,
+                                           detail::sse2::gainReduction, detail::sse2::logGain,
+                                           detail::sse2::antiderivative };
+    static const KernelTable avx2Table   { "AVX2", detail::avx2::biquad, detail::avx2::gainRamp,
+                                           detail::avx2::peak, detail::avx2::clip, detail::avx2::splitBands,
+                                           detail::avx2::gainReduction, detail::avx2::logGain,
+                                           detail::avx2::antiderivative };
+    static const KernelTable avx512Table { "AVX-512", detail::avx512::biquad, detail::avx512::gainRamp,
+                                           detail::avx512::peak, detail::avx512::clip, detail::avx512::splitBands,
+                                           detail::avx512::gainReduction, detail::avx512::logGain,
+                                           detail::avx512::antiderivative };
+
+    // feature detection runs once, the first time anybody asks
+    static const Variant best = []
+    {
+        if (SystemStats::hasAVX512F() && SystemStats::hasFMA3())  return Variant::avx512;
+        if (SystemStats::hasAVX2()    && SystemStats::hasFMA3())  return Variant::avx2;
+        if (SystemStats::hasSSE2())                               return Variant::sse2;
+        return Variant::scalar;
+    }();
+
+    if (variant == Variant::automatic || (int) variant > (int) best)
+        variant = best;
+
+    switch (variant)
+    {
+        case Variant::avx512:   return avx512Table;
+        case Variant::avx2:     return avx2Table;
+        case Variant::sse2:     return sse2Table;
+        case Variant::automatic:
+        case Variant::scalar:
+        default:                return scalarTable;
+    }
+   #else
+    // elsewhere the compiler's own vectorisation of the scalar loops is what we get
+    ignoreUnused (variant);
+    return scalarTable;
+   #endif
+}
+
+/** The variant named by the PLUGINTEMPLATE_KERNELS environment variable
+    ("scalar", "sse2", "avx2" or "avx512"), for benchmarking; automatic if unset.
+*/
+inline Variant getVariantFromEnvironment()
+{
+    auto name = SystemStats::getEnvironmentVariable ("PLUGINTEMPLATE_KERNELS", {}).trim().toLowerCase();
+
+    if (name == "scalar")   return Variant::scalar;
+    if (name == "sse2")     return Variant::sse2;
+    if (name == "avx2")     return Variant::avx2;
+    if (name == "avx512")   return Variant::avx512;
+
+    return Variant::automatic;
+}
+
+} // namespace DSPKernels
@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+    DSPServer.h
+
+    Headless host for the plugin's processor, serving local clients that
+    stream audio through it over shared memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+#include "SharedAudioRing.h"
+
+//==============================================================================
+/**
+    Clients connect over a localhost socket, which only carries small
+    messages; the audio itself sits in a SharedAudioRing the server makes
+    for each client.
+
+    - hello gives the format and the plugin state. The server makes a ring
+      in that format, builds a processor for this client alone (main bus
+      only, no sidechain), prepares it and answers ready with where to map
+      the ring. Each client gets a ring of its own, and never names one, so
+      nobody can point the server at another client's audio.
+    - process hands a slot over to the server, and done hands it back,
+      processed in place. The client doesn't touch a slot in between.
+    - anything else, or a process request for a slot or size the ring
+      doesn't have, is answered with error and the server hangs up, rather
+      than leave the client waiting on a block that will never come.
+
+    Every client gets its own processor, and blocks are processed in the
+    order they arrive, so each client sees exactly what a host would give it.
+    The work runs on a shared pool of threads, with at most one job per
+    client at any time. A client with several blocks queued keeps its worker
+    until the queue is empty, so its processor's state stays in that core's
+    cache.
+*/
+class DSPServer  : private InterProcessConnectionServer
+{
+public:
+    using ProcessorFactory = std::function<AudioProcessor*()>;
+
+    static constexpr int defaultPort = 50123;
+
+    /** numThreads 0 means one worker per core. */
+    DSPServer (ProcessorFactory factoryToUse, int numThreads = 0)
+        : factory (std::move (factoryToUse)),
+          pool (numThreads > 0 ? numThreads : SystemStats::getNumCpus())
+    {
+    }
+
+    ~DSPServer() override
+    {
+        stop();
+    }
+
+    //==============================================================================
+    /** Only listens on the loopback interface. */
+    bool start (int port = defaultPort)
+    {
+        return beginWaitingForSocket (port, "127.0.0.1");
+    }
+
+    /** Hangs up on every client and waits for their work to finish. */
+    void stop()
+    {
+        InterProcessConnectionServer::stop();
+
+        const ScopedLock sl (sessionLock);
+        sessions.clear();
+    }
+
+    int getNumClients() const
+    {
+        const ScopedLock sl (sessionLock);
+        auto numConnected = 0;
+
+        for (auto* session : sessions)
+            if (session->isConnected())
+                ++numConnected;
+
+        return numConnected;
+    }
+
+private:
+    //==============================================================================
+    class Session  : public InterProcessConnection
+    {
+    public:
+        explicit Session (DSPServer& ownerToUse)
+            : InterProcessConnection (false, SharedAudioRing::connectionMagic), owner (ownerToUse)
+        {
+            idle.signal();
+        }
+
+        ~Session() override
+        {
+            {
+                const ScopedLock sl (queueLock);
+                closing = true;
+            }
+
+            hangUp();
+
+            // the last job lets go of the lock after signalling, so take it once more before it goes
+            idle.wait();
+            const ScopedLock sl (queueLock);
+        }
+
+        bool isFinished() const noexcept        { return finished.load(); }
+
+        void connectionMade() override {}
+
+        void connectionLost() override
+        {
+            finished.store (true);
+        }
+
+        void messageReceived (const MemoryBlock& message) override
+        {
+            // whatever a rejected client sends while it's being hung up on goes unanswered
+            {
+                const ScopedLock sl (queueLock);
+
+                if (closing)
+                    return;
+            }
+
+            MemoryInputStream in (message, false);
+            auto type = in.readInt();
+
+            if (type == SharedAudioRing::hello && processor == nullptr)
+            {
+                auto numChannels = in.readInt();
+                auto maxBlockSize = in.readInt();
+                auto numSlots = in.readInt();
+                auto sampleRate = in.readDouble();
+                auto nonRealtime = in.readBool();
+                MemoryBlock state;
+                in.readIntoMemoryBlock (state, jmax (0, in.readInt()));
+
+                auto result = setUp (numChannels, maxBlockSize, numSlots, sampleRate, nonRealtime, state);
+
+                if (result.failed())
+                {
+                    reject (result.getErrorMessage());
+                    return;
+                }
+
+                MemoryOutputStream reply;
+                reply.writeInt (SharedAudioRing::ready);
+                reply.writeString (ring.getFileForClient().getFullPathName());
+                sendMessage (reply.getMemoryBlock());
+            }
+            else if (type == SharedAudioRing::process && processor != nullptr)
+            {
+                auto slot = in.readInt();
+                auto numSamples = in.readInt();
+
+                if (! isPositiveAndBelow (slot, ring.getNumSlots())
+                     || ! isPositiveAndNotGreaterThan (numSamples, ring.getMaxBlockSize()))
+                {
+                    reject ("Bad process request: slot " + String (slot) + ", " + String (numSamples) + " samples");
+                    return;
+                }
+
+                const ScopedLock sl (queueLock);
+
+                if (closing)
+                    return;
+
+                queue.push_back ({ slot, numSamples });
+
+                if (! scheduled)
+                {
+                    scheduled = true;
+                    idle.reset();
+                    owner.pool.addJob ([this] { processQueue(); });
+                }
+            }
+            else
+            {
+                reject ("Unexpected message " + String (type));
+            }
+        }
+
+    private:
+        struct Request
+        {
+            int slot, numSamples;
+        };
+
+        DSPServer& owner;
+        SharedAudioRing ring;
+        std::unique_ptr<AudioProcessor> processor;
+        MidiBuffer midi;
+
+        CriticalSection queueLock;
+        std::deque<Request> queue;
+        bool scheduled = false, closing = false, hangingUp = false;
+        WaitableEvent idle { true };
+        std::atomic<bool> finished { false };
+        CriticalSection disconnectLock;
+
+        Result setUp (int numChannels, int maxBlockSize, int numSlots, double sampleRate,
+                      bool nonRealtime, const MemoryBlock& state)
+        {
+            if (! ring.create (numChannels, maxBlockSize, numSlots, sampleRate))
+                return Result::fail ("Can't make a ring of " + String (numSlots) + " slots of " + String (numChannels)
+                                      + " channels by " + String (maxBlockSize) + " samples");
+
+            processor.reset (owner.factory());
+
+            // main bus only, so the ring's channels are the whole buffer
+            auto layout = processor->getBusesLayout();
+
+            for (int bus = 1; bus < layout.inputBuses.size(); ++bus)
+                layout.inputBuses.getReference (bus) = AudioChannelSet::disabled();
+
+            layout.getChannelSet (true, 0) = AudioChannelSet::canonicalChannelSet (numChannels);
+            layout.getChannelSet (false, 0) = AudioChannelSet::canonicalChannelSet (numChannels);
+
+            if (! processor->setBusesLayout (layout)
+                 || processor->getTotalNumInputChannels() != numChannels
+                 || processor->getTotalNumOutputChannels() != numChannels)
+            {
+                processor = nullptr;
+                return Result::fail ("The plugin can't process " + String (numChannels) + " channels");
+            }
+
+            if (state.getSize() > 0)
+                processor->setStateInformation (state.getData(), (int) state.getSize());
+
+            processor->setNonRealtime (nonRealtime);
+            processor->prepareToPlay (ring.getSampleRate(), ring.getMaxBlockSize());
+            return Result::ok();
+        }
+
+        /** Answers error, stops taking work and hangs up from a pool thread, as the connection can't close itself. */
+        void reject (const String& reason)
+        {
+            MemoryOutputStream reply;
+            reply.writeInt (SharedAudioRing::error);
+            reply.writeString (reason);
+            sendMessage (reply.getMemoryBlock());
+
+            const ScopedLock sl (queueLock);
+
+            if (closing)
+                return;
+
+            closing = true;
+            hangingUp = true;
+
+            if (! scheduled)
+            {
+                scheduled = true;
+                idle.reset();
+                owner.pool.addJob ([this] { processQueue(); });
+            }
+        }
+
+        // from a pool thread after a reject(), and from the destructor, which may come at the same time
+        void hangUp()
+        {
+            const ScopedLock sl (disconnectLock);
+            disconnect();
+        }
+
+        // runs on a pool thread, and only ever one at a time per session
+        void processQueue()
+        {
+            for (;;)
+            {
+                Request request;
+                auto hangUpNow = false;
+
+                {
+                    const ScopedLock sl (queueLock);
+
+                    if (hangingUp)
+                    {
+                        hangUpNow = true;
+                    }
+                    else if (queue.empty() || closing)
+                    {
+                        queue.clear();
+                        scheduled = false;
+                        idle.signal();
+                        return;
+                    }
+                    else
+                    {
+                        request = queue.front();
+                        queue.pop_front();
+                    }
+                }
+
+                // still counted as busy, so the session isn't deleted until the connection is down
+                if (hangUpNow)
+                {
+                    hangUp();
+
+                    const ScopedLock sl (queueLock);
+                    queue.clear();
+                    hangingUp = false;
+                    scheduled = false;
+                    idle.signal();
+                    return;
+                }
+
+                // straight from and back into the shared memory, with no copies
+                float* channels[SharedAudioRing::maxChannels] = {};
+
+                for (int channel = 0; channel < ring.getNumChannels(); ++channel)
+                    channels[channel] = ring.getChannel (request.slot, channel);
+
+                AudioBuffer<float> buffer (channels, ring.getNumChannels(), request.numSamples);
+                processor->processBlock (buffer, midi);
+                midi.clear();
+
+                MemoryOutputStream reply;
+                reply.writeInt (SharedAudioRing::done);
+                reply.writeInt (request.slot);
+                sendMessage (reply.getMemoryBlock());
+            }
+        }
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Session)
+    };
+
+    //==============================================================================
+    ProcessorFactory factory;
+    ThreadPool pool;
+    OwnedArray<Session> sessions;
+    CriticalSection sessionLock;
+
+    // called on the server's listening thread, which is also where hung-up sessions are cleared away
+    InterProcessConnection* createConnectionObject() override
+    {
+        const ScopedLock sl (sessionLock);
+
+        for (int i = sessions.size(); --i >= 0;)
+            if (sessions.getUnchecked (i)->isFinished())
+                sessions.remove (i);
+
+        return sessions.add (new Session (*this));
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DSPServer)
+};
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    DSPStateArena.h
+
+    One cache-line-aligned allocation that holds the processor's hot
+    per-block state, split into regions.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Each region starts on a cache line of its own, and regions are laid out
+    one after another in the order prepare() was given them. The state the
+    audio thread touches every block (scratch buffers, smoothing ramps,
+    filter state) therefore sits in one contiguous run of lines. It is not
+    scattered across the heap, so a host running hundreds of instances has
+    less to miss on.
+
+    Regions are plain arrays: structure-of-arrays layouts are up to whoever
+    owns each one. Nothing in here locks, and nothing but prepare()
+    allocates.
+*/
+class DSPStateArena
+{
+public:
+    static constexpr size_t cacheLineBytes = 64;
+    static constexpr size_t floatsPerCacheLine = cacheLineBytes / sizeof (float);
+    static constexpr int maxRegions = 8;
+
+    DSPStateArena() = default;
+
+    //==============================================================================
+    /** Lays out one region per size, in floats, and zeroes the lot. The only
+        place this allocates; every pointer handed out before is invalid after.
+    */
+    void prepare (std::initializer_list<size_t> regionSizes)
+    {
+        jassert (regionSizes.size() <= (size_t) maxRegions);
+
+        size_t total = 0;
+        numRegions = 0;
+
+        for (auto size : regionSizes)
+        {
+            offsets[numRegions++] = total;
+            total += roundUpToCacheLine (size);
+        }
+
+        // one extra line so the first region can start on a boundary
+        storage.reset (new float[total + floatsPerCacheLine]);
+        base = snapPointerToAlignment (storage.get(), cacheLineBytes);
+        numFloats = total;
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        std::fill (base, base + numFloats, 0.0f);
+    }
+
+    float* getRegion (int index) const noexcept
+    {
+        jassert (isPositiveAndBelow (index, numRegions));
+        return base + offsets[index];
+    }
+
+    /** For owners that want each of their own arrays inside a region to start on a line too. */
+    static constexpr size_t roundUpToCacheLine (size_t numFloatsToRound) noexcept
+    {
+        return (numFloatsToRound + floatsPerCacheLine - 1) / floatsPerCacheLine * floatsPerCacheLine;
+    }
+
+private:
+    std::unique_ptr<float[]> storage;
+    float* base = nullptr;
+    size_t numFloats = 0;
+    size_t offsets[maxRegions] {};
+    int numRegions = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DSPStateArena)
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    EnvelopeFollower.h
+
+    Peak envelope follower for the sidechain, running at control rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+//==============================================================================
+/**
+    Instead of smoothing every sample, this takes the peak of each control
+    period (32 samples by default) with the vectorised peak kernel, then runs
+    the attack/release smoothing once per period. That's all a cutoff
+    modulation needs, at a fraction of the cost.
+
+    Periods run on their own counter, so they don't depend on how the host or
+    the sub-block engine slice the audio. Feed it segments no longer than
+    getSamplesUntilUpdate().
+*/
+class EnvelopeFollower
+{
+public:
+    static constexpr int defaultControlInterval = 32;
+
+    EnvelopeFollower() = default;
+
+    //==============================================================================
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        setTimes (attackMs, releaseMs);
+        reset();
+    }
+
+    /** Shorter periods track faster and cost more; 1 updates every sample. */
+    void setControlInterval (int newControlInterval) noexcept
+    {
+        controlInterval = jmax (1, newControlInterval);
+        setTimes (attackMs, releaseMs);
+
+        periodPeak = 0.0f;
+        samplesUntilUpdate = controlInterval;
+    }
+
+    int getControlInterval() const noexcept         { return controlInterval; }
+
+    void setTimes (float newAttackMs, float newReleaseMs) noexcept
+    {
+        attackMs = newAttackMs;
+        releaseMs = newReleaseMs;
+
+        // one-pole coefficients for a step of controlInterval samples
+        auto coefficientFor = [this] (float ms)
+        {
+            return (float) std::exp (-(double) controlInterval / (jmax (0.01, (double) ms) * 0.001 * sampleRate));
+        };
+
+        attackCoefficient = coefficientFor (attackMs);
+        releaseCoefficient = coefficientFor (releaseMs);
+    }
+
+    void reset() noexcept
+    {
+        envelope = 0.0f;
+        periodPeak = 0.0f;
+        samplesUntilUpdate = controlInterval;
+    }
+
+    int getSamplesUntilUpdate() const noexcept      { return samplesUntilUpdate; }
+    float getEnvelope() const noexcept              { return envelope; }
+
+    //==============================================================================
+    /** Returns true when this segment finished a period, i.e. getEnvelope() has moved. */
+    bool process (const float* const* channels, int numChannels, int numSamples,
+                  DSPKernels::PeakFunction peak) noexcept
+    {
+        jassert (numSamples <= samplesUntilUpdate);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            periodPeak = jmax (periodPeak, peak (channels[channel], numSamples));
+
+        samplesUntilUpdate -= numSamples;
+
+        if (samplesUntilUpdate > 0)
+            return false;
+
+        auto coefficient = periodPeak > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = periodPeak + coefficient * (envelope - periodPeak);
+
+        periodPeak = 0.0f;
+        samplesUntilUpdate = controlInterval;
+        return true;
+    }
+
+private:
+    double sampleRate = 44100.0;
+    float attackMs = 5.0f, releaseMs = 150.0f;
+    float attackCoefficient = 0.0f, releaseCoefficient = 0.0f;
+    float envelope = 0.0f, periodPeak = 0.0f;
+    int controlInterval = defaultControlInterval;
+    int samplesUntilUpdate = defaultControlInterval;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EnvelopeFollower)
+};
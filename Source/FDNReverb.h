@@ -0,0 +1,251 @@
+/*
+  ==============================================================================
+
+    FDNReverb.h
+
+    Eight line feedback delay network reverb, worked a whole block at a time
+    so the mixing runs along the samples in SIMD.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Eight delay lines whose outputs are damped, scaled for the decay time,
+    mixed by an 8x8 Hadamard matrix and fed back in along with the input.
+    The left input feeds the even lines and the right the odd ones, and the
+    outputs are tapped the same way, so the matrix does the stereo spread.
+
+    Every line is longer than the largest block, which means a block never
+    reads anything it wrote itself. So instead of running the network one
+    sample at a time across eight lanes, each block:
+
+    - copies each line's next numSamples outputs into a row of its own
+    - damps and scales every row (a one-pole per line)
+    - takes the wet outputs from the rows
+    - mixes the rows with a fast Walsh-Hadamard transform, three stages of
+      butterflies, each one a plain add and subtract along two rows that
+      vectorises to full width
+    - adds the input and writes every row back into its line
+
+    The lines and the rows all live in one arena, allocated in prepare()
+    with every region starting on a cache line.
+*/
+class FDNReverb
+{
+public:
+    static constexpr int numLines = 8;
+
+    FDNReverb() = default;
+
+    //==============================================================================
+    /** The only place this allocates. */
+    void prepare (double newSampleRate, int maxSamplesPerBlock)
+    {
+        // mutually prime-ish lengths between 30 and 75 ms, so the echoes never line up
+        static const double lineMilliseconds[numLines] = { 29.7, 37.1, 41.1, 43.7, 53.3, 59.9, 67.1, 73.3 };
+
+        sampleRate = newSampleRate;
+        maxSamples = maxSamplesPerBlock;
+
+        size_t arenaSize = 0;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            lineLengths[line] = jmax (maxSamples, roundToInt (lineMilliseconds[line] * 0.001 * sampleRate));
+            arenaSize += roundUpToCacheLine ((size_t) lineLengths[line]);
+        }
+
+        arenaSize += (numLines + numWetRows) * roundUpToCacheLine ((size_t) maxSamples);
+
+        // one extra cache line so the first region can start on a boundary
+        arena.reset (new float[arenaSize + floatsPerCacheLine]);
+        auto* next = alignToCacheLine (arena.get());
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            lines[line] = next;
+            next += roundUpToCacheLine ((size_t) lineLengths[line]);
+        }
+
+        for (int row = 0; row < numLines + numWetRows; ++row)
+        {
+            rows[row] = next;
+            next += roundUpToCacheLine ((size_t) maxSamples);
+        }
+
+        arenaEnd = next;
+        setParameters (decaySeconds, dampingFrequency);
+        reset();
+    }
+
+    void setParameters (float newDecaySeconds, float newDampingFrequency) noexcept
+    {
+        decaySeconds = newDecaySeconds;
+        dampingFrequency = newDampingFrequency;
+
+        // -60 dB after decaySeconds, with the Hadamard's 1 / sqrt (8) folded in
+        for (int line = 0; line < numLines; ++line)
+            feedbackGains[line] = (float) (std::pow (10.0, -3.0 * lineLengths[line] / (jmax (0.05f, decaySeconds) * sampleRate))
+                                             / std::sqrt ((double) numLines));
+
+        dampingCoefficient = (float) std::exp (-MathConstants<double>::twoPi * jmin ((double) dampingFrequency, 0.49 * sampleRate) / sampleRate);
+    }
+
+    /** Empties every line, which touches the whole arena; not something to do every block. */
+    void reset() noexcept
+    {
+        if (arena != nullptr)
+            std::fill (alignToCacheLine (arena.get()), arenaEnd, 0.0f);
+
+        std::fill (std::begin (dampingState), std::end (dampingState), 0.0f);
+        position = 0;
+    }
+
+    //==============================================================================
+    /** Adds the reverb to the channels, at mixRamp[i] if there is one or mix if not. */
+    void process (float* const* channels, int numChannels, int numSamples,
+                  const float* mixRamp, float mix) noexcept
+    {
+        jassert (numSamples <= maxSamples && numChannels > 0);
+
+        if (numChannels > 1)
+            processBlock<true> (channels, numSamples, mixRamp, mix);
+        else
+            processBlock<false> (channels, numSamples, mixRamp, mix);
+    }
+
+private:
+    //==============================================================================
+    static constexpr int numWetRows = 2;
+    static constexpr size_t floatsPerCacheLine = 64 / sizeof (float);
+
+    std::unique_ptr<float[]> arena;
+    float* arenaEnd = nullptr;
+    float* lines[numLines] {};
+    float* rows[numLines + numWetRows] {};
+    int lineLengths[numLines] {};
+
+    float feedbackGains[numLines] {};
+    float dampingState[numLines] {};
+    float dampingCoefficient = 0.0f;
+    float decaySeconds = 2.0f, dampingFrequency = 8000.0f;
+
+    double sampleRate = 44100.0;
+    int maxSamples = 0;
+    int64 position = 0;
+
+    // mono still runs all eight lines, it just feeds them all from one input and has no right output to tap
+    template <bool stereo>
+    void processBlock (float* const* channels, int numSamples, const float* mixRamp, float mix) noexcept
+    {
+        auto* wetLeft = rows[numLines];
+        auto* wetRight = rows[numLines + 1];
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            auto* row = rows[line];
+            readLine (line, row, numSamples);
+
+            // damping and decay, the only recursive part, one line at a time
+            auto z = dampingState[line];
+            auto gain = feedbackGains[line];
+            auto c = dampingCoefficient;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                z = row[i] + c * (z - row[i]);
+                row[i] = gain * z;
+            }
+
+            dampingState[line] = z;
+        }
+
+        // the even lines are the left output and the odd ones the right
+        for (int i = 0; i < numSamples; ++i)
+        {
+            wetLeft[i] = rows[0][i] + rows[2][i] + rows[4][i] + rows[6][i];
+
+            if (stereo)
+                wetRight[i] = rows[1][i] + rows[3][i] + rows[5][i] + rows[7][i];
+        }
+
+        // fast Walsh-Hadamard transform across the lines, vectorised along the samples
+        for (int span = 1; span < numLines; span *= 2)
+        {
+            for (int first = 0; first < numLines; first += 2 * span)
+            {
+                for (int line = first; line < first + span; ++line)
+                {
+                    auto* a = rows[line];
+                    auto* b = rows[line + span];
+
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        auto sum = a[i] + b[i];
+                        b[i] = a[i] - b[i];
+                        a[i] = sum;
+                    }
+                }
+            }
+        }
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            auto* input = channels[stereo ? (line & 1) : 0];
+            FloatVectorOperations::add (rows[line], input, numSamples);
+            writeLine (line, rows[line], numSamples);
+        }
+
+        position += numSamples;
+
+        // scaled down so a long decay at full mix doesn't bury the dry signal
+        for (int channel = 0; channel < (stereo ? 2 : 1); ++channel)
+        {
+            auto* wet = channel == 0 ? wetLeft : wetRight;
+            FloatVectorOperations::multiply (wet, 0.5f, numSamples);
+
+            if (mixRamp != nullptr)
+                FloatVectorOperations::addWithMultiply (channels[channel], wet, mixRamp, numSamples);
+            else
+                FloatVectorOperations::addWithMultiply (channels[channel], wet, mix, numSamples);
+        }
+    }
+
+    static size_t roundUpToCacheLine (size_t numFloats) noexcept
+    {
+        return (numFloats + floatsPerCacheLine - 1) / floatsPerCacheLine * floatsPerCacheLine;
+    }
+
+    static float* alignToCacheLine (float* pointer) noexcept
+    {
+        return snapPointerToAlignment (pointer, 64);
+    }
+
+    // each line is a ring exactly as long as its delay, so the oldest sample is where the next one goes
+    void readLine (int line, float* destination, int numSamples) const noexcept
+    {
+        auto length = lineLengths[line];
+        auto start = (int) (position % length);
+        auto first = jmin (numSamples, length - start);
+
+        FloatVectorOperations::copy (destination, lines[line] + start, first);
+        FloatVectorOperations::copy (destination + first, lines[line], numSamples - first);
+    }
+
+    void writeLine (int line, const float* source, int numSamples) noexcept
+    {
+        auto length = lineLengths[line];
+        auto start = (int) (position % length);
+        auto first = jmin (numSamples, length - start);
+
+        FloatVectorOperations::copy (lines[line] + start, source, first);
+        FloatVectorOperations::copy (lines[line], source + first, numSamples - first);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FDNReverb)
+};
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    FFT.h
+
+    Small power-of-two real FFT for the block convolution stages.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+/**
+    Real-to-complex FFT of size 2^order, done as a half-size complex FFT plus a
+    split step. Tables are built in the constructor, so create these off the
+    audio thread; perform() never allocates.
+
+    Spectra hold getNumBins() = size / 2 + 1 bins. The inverse is scaled by
+    1 / size so that forward followed by inverse is the identity.
+*/
+class RealFFT
+{
+public:
+    using Complex = std::complex<float>;
+
+    explicit RealFFT (int order)
+        : size (1 << order), halfSize (size / 2)
+    {
+        jassert (order >= 2);
+
+        // twiddles for the half-size complex transform
+        complexTwiddles.resize ((size_t) halfSize / 2);
+
+        for (int i = 0; i < halfSize / 2; ++i)
+            complexTwiddles[(size_t) i] = std::polar (1.0, -MathConstants<double>::twoPi * i / halfSize);
+
+        // twiddles for the real split step
+        splitTwiddles.resize ((size_t) halfSize);
+
+        for (int i = 0; i < halfSize; ++i)
+            splitTwiddles[(size_t) i] = std::polar (1.0, -MathConstants<double>::twoPi * i / size);
+
+        bitReversed.resize ((size_t) halfSize);
+
+        for (int i = 0, bits = order - 1; i < halfSize; ++i)
+        {
+            int reversed = 0;
+
+            for (int b = 0; b < bits; ++b)
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+
+            bitReversed[(size_t) i] = reversed;
+        }
+
+        work.resize ((size_t) halfSize);
+    }
+
+    int getSize() const noexcept        { return size; }
+    int getNumBins() const noexcept     { return halfSize + 1; }
+
+    //==============================================================================
+    /** Transforms size real samples into getNumBins() complex bins. */
+    void forward (const float* input, Complex* output) noexcept
+    {
+        auto* z = work.data();
+
+        for (int i = 0; i < halfSize; ++i)
+            z[bitReversed[(size_t) i]] = { input[2 * i], input[2 * i + 1] };
+
+        butterflies (z, false);
+
+        output[0]        = { z[0].real() + z[0].imag(), 0.0f };
+        output[halfSize] = { z[0].real() - z[0].imag(), 0.0f };
+
+        for (int k = 1; k < halfSize; ++k)
+        {
+            auto a = z[k];
+            auto b = std::conj (z[halfSize - k]);
+
+            auto even = 0.5f * (a + b);
+            auto odd  = Complex (0.0f, -0.5f) * (a - b);
+
+            output[k] = even + splitTwiddles[(size_t) k] * odd;
+        }
+    }
+
+    /** Transforms getNumBins() complex bins back into size real samples. */
+    void inverse (const Complex* input, float* output) noexcept
+    {
+        auto* z = work.data();
+        auto scale = 1.0f / (float) size;
+
+        for (int k = 0; k < halfSize; ++k)
+        {
+            auto a = input[k];
+            auto b = std::conj (input[halfSize - k]);
+
+            auto even = a + b;
+            auto odd  = (a - b) * std::conj (splitTwiddles[(size_t) k]);
+
+            z[bitReversed[(size_t) k]] = scale * (even + Complex (0.0f, 1.0f) * odd);
+        }
+
+        butterflies (z, true);
+
+        for (int i = 0; i < halfSize; ++i)
+        {
+            output[2 * i]     = z[i].real();
+            output[2 * i + 1] = z[i].imag();
+        }
+    }
+
+private:
+    int size, halfSize;
+    std::vector<Complex> complexTwiddles, splitTwiddles, work;
+    std::vector<int> bitReversed;
+
+    void butterflies (Complex* z, bool inverse) const noexcept
+    {
+        for (int span = 1, stride = halfSize / 2; span < halfSize; span *= 2, stride /= 2)
+        {
+            for (int start = 0; start < halfSize; start += 2 * span)
+            {
+                for (int i = 0; i < span; ++i)
+                {
+                    auto w = complexTwiddles[(size_t) (i * stride)];
+
+                    if (inverse)
+                        w = std::conj (w);
+
+                    auto& a = z[start + i];
+                    auto& b = z[start + i + span];
+                    auto t = w * b;
+
+                    b = a - t;
+                    a += t;
+                }
+            }
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealFFT)
+};
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    FlightRecorder.h
+
+    Always-on record of what the audio thread did recently, for working out
+    what led up to an intermittent dropout.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    A fixed ring of small POD events. The audio thread is the only writer and
+    record() is just a store and an atomic increment, so it can stay on all
+    the time. A block is usually two events, so with blocks of 64 samples at
+    48 kHz the ring holds the last 2.7 seconds, and at 512 about 20.
+
+    That's 96 KB for every instance in a session, which is still only worth
+    paying once an instance plays, so it's allocated by prepare() and
+    instances that never are (a plugin scan, say) go without.
+
+    Any other thread can take a snapshot() at any time. Events the writer may
+    have overwritten while they were being copied are dropped rather than
+    returned half-written. Snapshots can be turned into Chrome trace JSON,
+    which chrome://tracing and ui.perfetto.dev both open.
+*/
+class FlightRecorder
+{
+public:
+    static constexpr int capacity = 1 << 12;
+
+    enum class EventType : uint8
+    {
+        blockStart,         // data = number of samples
+        blockEnd,           // data = number of samples
+        update,
+        parameterChange,    // data = parameter index, value = new value
+        clip,               // data = channels that clipped, value = block peak
+        denormals,          // data = subnormal values found
+        xrun,               // value = block time as a fraction of the deadline
+        qualityLevel        // data = CPU governor level, value = average load
+    };
+
+    struct Event
+    {
+        int64 ticks;
+        float value;
+        int32 data;
+        EventType type;
+    };
+
+    FlightRecorder() = default;
+
+    /** Allocates the ring the first time; call it before the audio thread starts recording. */
+    void prepare()
+    {
+        if (events.empty())
+            events.resize ((size_t) capacity);
+    }
+
+    //==============================================================================
+    /** Audio thread only, as is record(). For when the caller already has the time. */
+    void recordAt (EventType type, int64 ticks, int data = 0, float value = 0.0f) noexcept
+    {
+        jassert (! events.empty());
+        auto index = writeIndex.load (std::memory_order_relaxed);
+        events[(size_t) (index & (capacity - 1))] = { ticks, value, (int32) data, type };
+        writeIndex.store (index + 1, std::memory_order_release);
+    }
+
+    void record (EventType type, int data = 0, float value = 0.0f) noexcept
+    {
+        recordAt (type, Time::getHighResolutionTicks(), data, value);
+    }
+
+    /** Copies out everything still in the ring, oldest first. Any thread but the audio one. */
+    void snapshot (std::vector<Event>& destination) const
+    {
+        auto end = writeIndex.load (std::memory_order_acquire);
+        auto start = end > (uint64) capacity ? end - (uint64) capacity : 0;
+
+        destination.clear();
+        destination.reserve ((size_t) (end - start));
+
+        for (auto index = start; index < end; ++index)
+            destination.push_back (events[(size_t) (index & (capacity - 1))]);
+
+        // whatever the writer has lapped (or is writing now) since we started can't be trusted
+        auto firstSafe = writeIndex.load (std::memory_order_acquire) + 1;
+        auto overwritten = firstSafe > start + (uint64) capacity
+                             ? jmin (firstSafe - (uint64) capacity - start, (uint64) destination.size())
+                             : (uint64) 0;
+
+        destination.erase (destination.begin(), destination.begin() + (std::ptrdiff_t) overwritten);
+    }
+
+    //==============================================================================
+    /** Blocks become duration slices, parameters counter tracks, everything else instant events. */
+    static String toTraceJson (const std::vector<Event>& recorded, const StringArray& parameterNames)
+    {
+        if (recorded.empty())
+            return "{\"traceEvents\":[]}";
+
+        auto origin = recorded.front().ticks;
+        auto toMicroseconds = [origin] (int64 ticks)
+        {
+            return String (Time::highResolutionTicksToSeconds (ticks - origin) * 1.0e6, 3);
+        };
+
+        StringArray lines;
+
+        for (auto& event : recorded)
+        {
+            auto common = "\"pid\":1,\"tid\":1,\"ts\":" + toMicroseconds (event.ticks);
+
+            switch (event.type)
+            {
+                case EventType::blockStart:
+                    lines.add ("{\"name\":\"processBlock\",\"ph\":\"B\"," + common
+                                + ",\"args\":{\"samples\":" + String (event.data) + "}}");
+                    break;
+
+                case EventType::blockEnd:
+                    lines.add ("{\"name\":\"processBlock\",\"ph\":\"E\"," + common + "}");
+                    break;
+
+                case EventType::update:
+                    lines.add ("{\"name\":\"update\",\"ph\":\"i\",\"s\":\"t\"," + common + "}");
+                    break;
+
+                case EventType::parameterChange:
+                    lines.add ("{\"name\":\"" + parameterNames[event.data] + "\",\"ph\":\"C\"," + common
+                                + ",\"args\":{\"value\":" + String (event.value) + "}}");
+                    break;
+
+                case EventType::clip:
+                    lines.add ("{\"name\":\"clip\",\"ph\":\"i\",\"s\":\"t\"," + common
+                                + ",\"args\":{\"channels\":" + String (event.data) + ",\"peak\":" + String (event.value) + "}}");
+                    break;
+
+                case EventType::denormals:
+                    lines.add ("{\"name\":\"denormals\",\"ph\":\"i\",\"s\":\"t\"," + common
+                                + ",\"args\":{\"count\":" + String (event.data) + "}}");
+                    break;
+
+                case EventType::xrun:
+                    lines.add ("{\"name\":\"xrun\",\"ph\":\"i\",\"s\":\"g\"," + common
+                                + ",\"args\":{\"deadlineFraction\":" + String (event.value) + "}}");
+                    break;
+
+                case EventType::qualityLevel:
+                    lines.add ("{\"name\":\"qualityLevel\",\"ph\":\"C\"," + common
+                                + ",\"args\":{\"level\":" + String (event.data) + ",\"load\":" + String (event.value) + "}}");
+                    break;
+
+                default:
+                    jassertfalse;
+                    break;
+            }
+        }
+
+        return "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" + lines.joinIntoString (",\n") + "\n]}\n";
+    }
+
+private:
+    std::vector<Event> events;
+    std::atomic<uint64> writeIndex { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FlightRecorder)
+};
@@ -0,0 +1,291 @@
+/*
+  ==============================================================================
+
+    InstanceBenchmark.h
+
+    Loads the plugin the way a big template does, hundreds or thousands of
+    instances in one process, and logs what each one costs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#endif
+
+//==============================================================================
+/**
+    Every instance is constructed and given the same state, optionally gets an
+    editor, and is prepared, one phase at a time across all of them so each
+    phase can be timed and its memory measured on its own. Then they are
+    processed round-robin like a host graph would: one pass over every
+    instance per block, each on its own copy of the same noise.
+
+    Before any of that, two things a session load or a plugin scan notices
+    most are timed apart: the very first instance in the process, which
+    also sets up whatever all instances share, and up to 100 instances
+    made and deleted straight away, the way a scan does. Each instance's
+    first block after prepareToPlay is timed on its own too.
+
+    Memory is the process's resident set, read before and after each phase,
+    so it includes whatever the allocator keeps around; with a thousand
+    instances that averages out. It is only measured on Linux and macOS.
+
+    Editors have to be made on the message thread, so that's where run()
+    belongs when withEditors is on.
+*/
+class InstanceBenchmark
+{
+public:
+    using ProcessorFactory = std::function<AudioProcessor*()>;
+
+    struct Options
+    {
+        int numInstances = 1000;
+        int blockSize = 512;
+        double sampleRate = 48000.0;
+        int numBlocks = 100;              // passes over every instance
+        bool withEditors = false;
+    };
+
+    InstanceBenchmark (ProcessorFactory factory, const MemoryBlock& stateToUse, Options optionsToUse)
+        : createProcessor (std::move (factory)), state (stateToUse), options (optionsToUse)
+    {
+        options.numInstances = jmax (1, options.numInstances);
+        options.blockSize = jmax (1, options.blockSize);
+        options.numBlocks = jmax (1, options.numBlocks);
+    }
+
+    //==============================================================================
+    void run()
+    {
+        auto n = options.numInstances;
+
+        // the first instance in the process also pays for everything instances share
+        auto cold = timeFirstInstance();
+        auto scanSeconds = timeScan();
+        auto memoryAtStart = getResidentBytes();
+
+        std::vector<std::unique_ptr<AudioProcessor>> processors;
+        std::vector<std::unique_ptr<AudioProcessorEditor>> editors;
+        processors.reserve ((size_t) n);
+        editors.reserve ((size_t) n);
+
+        auto constructionSeconds = timePhase ([&]
+        {
+            for (int i = 0; i < n; ++i)
+                processors.push_back (createWithState());
+        });
+
+        auto memoryConstructed = getResidentBytes();
+
+        auto editorSeconds = timePhase ([&]
+        {
+            if (options.withEditors)
+                for (auto& processor : processors)
+                    editors.emplace_back (processor->createEditorIfNeeded());
+        });
+
+        auto memoryWithEditors = getResidentBytes();
+        auto numChannels = 1;
+
+        auto prepareSeconds = timePhase ([&]
+        {
+            for (auto& processor : processors)
+                numChannels = jmax (numChannels, prepare (*processor));
+        });
+
+        auto memoryPrepared = getResidentBytes();
+
+        //==============================================================================
+        AudioBuffer<float> noise, buffer (numChannels, options.blockSize);
+        MidiBuffer midi;
+        fillNoise (noise, numChannels);
+
+        // each instance's first block is where anything left lazy gets paid for, so it's timed on its own
+        auto firstBlockTotal = 0.0, firstBlockWorst = 0.0;
+
+        for (auto& processor : processors)
+        {
+            buffer.makeCopyOf (noise, true);
+            auto seconds = timePhase ([&] { processor->processBlock (buffer, midi); });
+
+            firstBlockTotal += seconds;
+            firstBlockWorst = jmax (firstBlockWorst, seconds);
+        }
+
+        auto totalSeconds = 0.0, worstSeconds = 0.0;
+
+        for (int block = 0; block < options.numBlocks; ++block)
+        {
+            auto seconds = timePhase ([&]
+            {
+                for (auto& processor : processors)
+                {
+                    buffer.makeCopyOf (noise, true);
+                    processor->processBlock (buffer, midi);
+                }
+            });
+
+            totalSeconds += seconds;
+            worstSeconds = jmax (worstSeconds, seconds);
+        }
+
+        editors.clear();
+
+        for (auto& processor : processors)
+            processor->releaseResources();
+
+        processors.clear();
+
+        //==============================================================================
+        auto milliseconds = [] (double seconds)     { return String (seconds * 1000.0, 3) + " ms"; };
+        auto perInstance = [n] (double seconds)     { return String (seconds * 1000.0 / n, 3) + " ms each"; };
+        auto perInstanceMB = [n] (int64 before, int64 after)
+        {
+            return before < 0 || after < 0 ? String ("not measured")
+                                            : String ((double) (after - before) / (n * 1024.0 * 1024.0), 3) + " MB each";
+        };
+
+        auto deadline = options.blockSize / options.sampleRate;
+        auto averageSeconds = totalSeconds / options.numBlocks;
+
+        Logger::writeToLog (String (n) + " instances, " + String (options.blockSize) + " sample blocks at "
+                             + String (options.sampleRate / 1000.0, 1) + " kHz");
+        Logger::writeToLog ("First instance: " + milliseconds (cold.construction) + " to construct, "
+                             + (options.withEditors ? milliseconds (cold.editor) + " for its editor, " : String())
+                             + milliseconds (cold.prepare) + " to prepare, "
+                             + milliseconds (cold.firstBlock) + " for its first block");
+        Logger::writeToLog ("Scan (construct and delete): " + String (scanSeconds * 1000.0 / numScanned(), 3) + " ms each");
+        Logger::writeToLog ("Construction: " + perInstance (constructionSeconds) + ", "
+                             + perInstanceMB (memoryAtStart, memoryConstructed));
+
+        if (options.withEditors)
+            Logger::writeToLog ("Editors: " + perInstance (editorSeconds) + ", "
+                                 + perInstanceMB (memoryConstructed, memoryWithEditors));
+
+        Logger::writeToLog ("prepareToPlay: " + perInstance (prepareSeconds) + ", "
+                             + perInstanceMB (memoryWithEditors, memoryPrepared));
+        Logger::writeToLog ("First block after prepareToPlay: " + perInstance (firstBlockTotal) + ", "
+                             + milliseconds (firstBlockWorst) + " worst");
+        Logger::writeToLog ("Every instance once per block: " + String (averageSeconds * 1000.0, 3) + " ms on average, "
+                             + String (worstSeconds * 1000.0, 3) + " ms worst, "
+                             + String (100.0 * averageSeconds / deadline, 1) + "% of the "
+                             + String (deadline * 1000.0, 2) + " ms deadline, "
+                             + String (averageSeconds * 1.0e6 / n, 2) + " us per instance");
+    }
+
+    /** The process's resident set in bytes, or -1 where we can't tell. */
+    static int64 getResidentBytes()
+    {
+       #if JUCE_LINUX
+        // the second field of statm is the resident set, in pages
+        auto fields = StringArray::fromTokens (File ("/proc/self/statm").loadFileAsString(), false);
+        return fields.size() > 1 ? fields[1].getLargeIntValue() * (int64) sysconf (_SC_PAGESIZE) : -1;
+       #elif JUCE_MAC
+        mach_task_basic_info info {};
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info (mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+            return -1;
+
+        return (int64) info.resident_size;
+       #else
+        return -1;
+       #endif
+    }
+
+private:
+    //==============================================================================
+    ProcessorFactory createProcessor;
+    MemoryBlock state;
+    Options options;
+
+    struct FirstInstanceTimes
+    {
+        double construction = 0.0, editor = 0.0, prepare = 0.0, firstBlock = 0.0;
+    };
+
+    int numScanned() const noexcept     { return jmin (options.numInstances, 100); }
+
+    std::unique_ptr<AudioProcessor> createWithState()
+    {
+        std::unique_ptr<AudioProcessor> processor (createProcessor());
+
+        if (state.getSize() > 0)
+            processor->setStateInformation (state.getData(), (int) state.getSize());
+
+        return processor;
+    }
+
+    /** Returns the number of channels to process it with. */
+    int prepare (AudioProcessor& processor)
+    {
+        processor.setRateAndBufferSizeDetails (options.sampleRate, options.blockSize);
+        processor.prepareToPlay (options.sampleRate, options.blockSize);
+
+        return jmax (1, processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+    }
+
+    void fillNoise (AudioBuffer<float>& noise, int numChannels)
+    {
+        Random random;
+        noise.setSize (numChannels, options.blockSize);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < options.blockSize; ++i)
+                noise.setSample (channel, i, random.nextFloat() * 0.5f - 0.25f);
+    }
+
+    FirstInstanceTimes timeFirstInstance()
+    {
+        FirstInstanceTimes times;
+        std::unique_ptr<AudioProcessor> processor;
+        std::unique_ptr<AudioProcessorEditor> editor;
+        AudioBuffer<float> buffer;
+        MidiBuffer midi;
+        auto numChannels = 1;
+
+        times.construction = timePhase ([&] { processor = createWithState(); });
+
+        if (options.withEditors)
+            times.editor = timePhase ([&] { editor.reset (processor->createEditorIfNeeded()); });
+
+        times.prepare = timePhase ([&] { numChannels = prepare (*processor); });
+        fillNoise (buffer, numChannels);
+        times.firstBlock = timePhase ([&] { processor->processBlock (buffer, midi); });
+
+        editor = nullptr;
+        processor->releaseResources();
+        return times;
+    }
+
+    /** What a host's plugin scan does to each instance, more or less: make it, ask it things, delete it. */
+    double timeScan()
+    {
+        return timePhase ([this]
+        {
+            for (int i = 0; i < numScanned(); ++i)
+            {
+                std::unique_ptr<AudioProcessor> processor (createProcessor());
+                ignoreUnused (processor->getName(), processor->getTotalNumInputChannels(), processor->hasEditor());
+            }
+        });
+    }
+
+    template <typename Function>
+    static double timePhase (Function&& phase)
+    {
+        auto start = Time::getHighResolutionTicks();
+        phase();
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InstanceBenchmark)
+};
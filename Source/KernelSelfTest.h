@@ -0,0 +1,600 @@
+/*
+  ==============================================================================
+
+    KernelSelfTest.h
+
+    Checks every SIMD kernel against the scalar one, at every instruction
+    set this CPU can run.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+#include "MultibandCrossover.h"
+#include "PluginProcessor.h"
+#include "ProcessorChain.h"
+
+//==============================================================================
+/**
+    The scalar kernels are the reference: they are the plain loops, and the
+    SIMD ones are only allowed to differ from them by rounding. Each kernel
+    gets the same seeded noise in both variants, at lengths around every
+    vector width (so each tail loop runs) and in one and two channels, and
+    the largest difference is checked against a tolerance:
+
+    - peak and clip only compare and select, so they must match exactly
+    - everything else may differ by the reordering, accumulated ramps and
+      fused multiply-adds of the wider variants, but by no more than -80 dB
+    - the clipper's antiderivatives are in double and get divided by tiny
+      input steps later, so they must agree to 1e-12
+    - the biquad is swept over sample rates from 44.1 to 192 kHz, cutoffs up
+      to just under Nyquist and Qs up to 40, where its rounding differences
+      are amplified most; its error is relative to the output's peak
+
+    Then the whole processor runs in both variants side by side at every
+    sample rate, with every parameter (bar the ones that change latency or
+    depend on timing) set to new random values every few blocks, so the
+    smoothed ramps are checked as well. Its output may differ by -60 dB.
+
+    Variants the CPU can't run are skipped, as getKernels() would never
+    hand them out here anyway.
+
+    Before any of that, ProcessorChain's fused per-sample loops are checked
+    on a small chain of their own, as the processor's chain is all block
+    stages: two runs of per-sample stages around a block stage must give
+    exactly what running each stage over the whole block in turn gives, and
+    a run whose stages all have nothing to do must not touch a sample.
+*/
+class KernelSelfTest
+{
+public:
+    /** Logs one line per kernel and variant. Returns false if any were out of tolerance. */
+    static bool run()
+    {
+        using DSPKernels::Variant;
+
+        auto& reference = DSPKernels::getKernels (Variant::scalar);
+        auto* previous = &reference;
+        auto passed = testChain();
+
+        const struct { Variant variant; const char* name; } variants[] = { { Variant::sse2,   "SSE2" },
+                                                                           { Variant::avx2,   "AVX2" },
+                                                                           { Variant::avx512, "AVX-512" } };
+
+        for (auto& variant : variants)
+        {
+            auto& tested = DSPKernels::getKernels (variant.variant);
+
+            // getKernels() falls back to the best the CPU has, which has already been checked
+            if (&tested == previous)
+            {
+                Logger::writeToLog (String (variant.name) + " not supported here, skipped");
+                continue;
+            }
+
+            KernelSelfTest test (variant.variant);
+            passed = test.runAll() && passed;
+            previous = &tested;
+        }
+
+        Logger::writeToLog (passed ? "All kernels match the scalar reference" : "Kernel self-test FAILED");
+        return passed;
+    }
+
+private:
+    //==============================================================================
+    static constexpr int maxLength = 1024;
+    static constexpr int maxChannels = 2;
+    static constexpr float roundingTolerance = 1.0e-4f;     // -80 dB
+    static constexpr float processorTolerance = 1.0e-3f;    // -60 dB
+    static constexpr float antiderivativeTolerance = 1.0e-12f;
+
+    const DSPKernels::Variant testedVariant;
+    const DSPKernels::KernelTable& reference;
+    const DSPKernels::KernelTable& tested;
+
+    // either side of each vector width, and a few whole sub-blocks
+    std::vector<int> lengths { 0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 256, 257, 1024 };
+
+    AudioBuffer<float> input { maxChannels, maxLength },
+                       expected { maxChannels, maxLength },
+                       actual { maxChannels, maxLength };
+    float expectedScratch[maxLength], actualScratch[maxLength];
+    double expectedAntiderivatives[maxLength], actualAntiderivatives[maxLength];
+    Random random { 0x5eed };
+    bool allPassed = true;
+
+    explicit KernelSelfTest (DSPKernels::Variant variantToTest)
+        : testedVariant (variantToTest),
+          reference (DSPKernels::getKernels (DSPKernels::Variant::scalar)),
+          tested (DSPKernels::getKernels (variantToTest))
+    {
+    }
+
+    bool runAll()
+    {
+        check ("biquad",         testBiquad(),          roundingTolerance);
+        check ("gainRamp",       testGainRamp(),        roundingTolerance);
+        check ("peak",           testPeak(),            0.0f);
+        check ("clip",           testClip(),            0.0f);
+        check ("splitBands",     testSplitBands(),      roundingTolerance);
+        check ("gainReduction",  testGainReduction(),   roundingTolerance);
+        check ("logGain",        testLogGain(),         roundingTolerance);
+        check ("antiderivative", testAntiderivative(),  antiderivativeTolerance);
+        check ("processor",      testProcessor(),       processorTolerance);
+
+        return allPassed;
+    }
+
+    void check (const char* kernel, float error, float tolerance)
+    {
+        auto ok = error <= tolerance;
+        allPassed = allPassed && ok;
+
+        Logger::writeToLog (String (tested.name) + " " + kernel + ": max error " + String (error, 9)
+                             + (ok ? " ok" : " FAILED, tolerance " + String (tolerance, 9)));
+    }
+
+    //==============================================================================
+    /** Fills the input with noise in [-amplitude, amplitude] and copies it to both outputs. */
+    void fillNoise (int numSamples, float amplitude)
+    {
+        for (int channel = 0; channel < maxChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                input.setSample (channel, i, amplitude * (random.nextFloat() * 2.0f - 1.0f));
+
+        for (int channel = 0; channel < maxChannels; ++channel)
+        {
+            expected.copyFrom (channel, 0, input, channel, 0, numSamples);
+            actual.copyFrom (channel, 0, input, channel, 0, numSamples);
+        }
+    }
+
+    float maxDifference (int numChannels, int numSamples) const
+    {
+        auto error = 0.0f;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            error = jmax (error, maxDifference (expected.getReadPointer (channel), actual.getReadPointer (channel), numSamples));
+
+        return error;
+    }
+
+    static float maxDifference (const float* a, const float* b, int numSamples) noexcept
+    {
+        auto error = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+            error = jmax (error, std::abs (a[i] - b[i]));
+
+        return error;
+    }
+
+    //==============================================================================
+    float testBiquad()
+    {
+        const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+        const double cutoffs[] = { 20.0, 200.0, 2000.0, 12000.0, 0.45 };     // the last is a fraction of the rate
+        const double qs[] = { 0.5, 0.7071, 2.0, 10.0, 40.0 };
+        auto error = 0.0f;
+
+        for (auto sampleRate : sampleRates)
+        {
+            for (auto cutoff : cutoffs)
+            {
+                auto frequency = cutoff < 1.0 ? cutoff * sampleRate : cutoff;
+
+                for (auto q : qs)
+                {
+                    auto lowPass = IIRCoefficients::makeLowPass (sampleRate, frequency, q);
+
+                    // the state carries over from one length to the next, and each is run in two calls
+                    float expectedState[2] = {}, actualState[2] = {};
+
+                    for (auto numSamples : lengths)
+                    {
+                        fillNoise (numSamples, 1.0f);
+
+                        auto split = numSamples / 3;
+
+                        reference.biquad (expected.getWritePointer (0), split, lowPass.coefficients, expectedState);
+                        reference.biquad (expected.getWritePointer (0, split), numSamples - split, lowPass.coefficients, expectedState);
+                        tested.biquad (actual.getWritePointer (0), split, lowPass.coefficients, actualState);
+                        tested.biquad (actual.getWritePointer (0, split), numSamples - split, lowPass.coefficients, actualState);
+
+                        // a resonant filter's output, and so its rounding, is as large as its gain
+                        auto scale = jmax (1.0f, expected.getMagnitude (0, 0, numSamples));
+
+                        error = jmax (error, maxDifference (1, numSamples) / scale,
+                                      maxDifference (expectedState, actualState, 2) / scale);
+                    }
+                }
+            }
+        }
+
+        return error;
+    }
+
+    float testGainRamp()
+    {
+        auto error = 0.0f;
+
+        for (auto numSamples : lengths)
+        {
+            fillNoise (numSamples, 1.0f);
+
+            auto startGain = random.nextFloat() * 2.0f;
+            auto increment = (random.nextFloat() - 0.5f) / (float) jmax (1, numSamples);
+
+            reference.gainRamp (expected.getWritePointer (0), numSamples, startGain, increment);
+            tested.gainRamp (actual.getWritePointer (0), numSamples, startGain, increment);
+
+            error = jmax (error, maxDifference (1, numSamples));
+        }
+
+        return error;
+    }
+
+    float testPeak()
+    {
+        auto error = 0.0f;
+
+        for (auto numSamples : lengths)
+        {
+            fillNoise (numSamples, 0.5f);
+
+            // one spike somewhere, so the largest value lands in every lane and tail in turn
+            if (numSamples > 0)
+                input.setSample (0, random.nextInt (numSamples), -0.9f);
+
+            auto* data = input.getReadPointer (0);
+            error = jmax (error, std::abs (reference.peak (data, numSamples) - tested.peak (data, numSamples)));
+        }
+
+        return error;
+    }
+
+    float testClip()
+    {
+        auto error = 0.0f;
+
+        for (auto numSamples : lengths)
+        {
+            fillNoise (numSamples, 2.0f);
+
+            reference.clip (expected.getWritePointer (0), numSamples, 0.7f);
+            tested.clip (actual.getWritePointer (0), numSamples, 0.7f);
+
+            error = jmax (error, maxDifference (1, numSamples));
+        }
+
+        return error;
+    }
+
+    float testSplitBands()
+    {
+        const float frequencies[] = { 150.0f, 900.0f, 3500.0f, 11000.0f };
+        float startGains[MultibandCrossover::maxBands], endGains[MultibandCrossover::maxBands];
+        auto error = 0.0f;
+
+        for (int numBands = MultibandCrossover::minBands; numBands <= MultibandCrossover::maxBands; ++numBands)
+        {
+            for (int numChannels = 1; numChannels <= maxChannels; ++numChannels)
+            {
+                MultibandCrossover expectedBands, actualBands;
+
+                for (auto* bands : { &expectedBands, &actualBands })
+                {
+                    bands->prepare (48000.0);
+                    bands->setBands (numBands, frequencies);
+                }
+
+                // one block after another, so the filter state carries over
+                for (auto numSamples : lengths)
+                {
+                    fillNoise (numSamples, 1.0f);
+
+                    for (int band = 0; band < numBands; ++band)
+                    {
+                        startGains[band] = random.nextFloat() * 2.0f;
+                        endGains[band] = random.nextFloat() * 2.0f;
+                    }
+
+                    expectedBands.process (expected.getArrayOfWritePointers(), numChannels, numSamples,
+                                           startGains, endGains, 0.8f, reference.splitBands);
+                    actualBands.process (actual.getArrayOfWritePointers(), numChannels, numSamples,
+                                         startGains, endGains, 0.8f, tested.splitBands);
+
+                    error = jmax (error, maxDifference (numChannels, numSamples));
+                }
+            }
+        }
+
+        return error;
+    }
+
+    float testGainReduction()
+    {
+        // -12 dB, 4:1, 6 dB knee, in log2 units
+        const DSPKernels::GainCurve curve { -2.0f, 0.5f, 0.5f, 0.75f };
+        auto error = 0.0f;
+
+        for (int numChannels = 1; numChannels <= maxChannels; ++numChannels)
+        {
+            for (auto numSamples : lengths)
+            {
+                // from silence to well over the threshold, through the knee
+                fillNoise (numSamples, 1.0f);
+
+                for (int i = 0; i < numSamples; i += 7)
+                    input.setSample (0, i, 0.0f);
+
+                auto expectedLargest = reference.gainReduction (input.getArrayOfReadPointers(), numChannels,
+                                                                expectedScratch, numSamples, curve);
+                auto actualLargest = tested.gainReduction (input.getArrayOfReadPointers(), numChannels,
+                                                           actualScratch, numSamples, curve);
+
+                error = jmax (error, std::abs (expectedLargest - actualLargest),
+                              maxDifference (expectedScratch, actualScratch, numSamples));
+            }
+        }
+
+        return error;
+    }
+
+    float testLogGain()
+    {
+        auto error = 0.0f;
+
+        for (int numChannels = 1; numChannels <= maxChannels; ++numChannels)
+        {
+            for (auto numSamples : lengths)
+            {
+                fillNoise (numSamples, 1.0f);
+
+                // -24 dB to +6 dB
+                for (int i = 0; i < numSamples; ++i)
+                    expectedScratch[i] = random.nextFloat() * 5.0f - 4.0f;
+
+                reference.logGain (expected.getArrayOfWritePointers(), numChannels, expectedScratch, numSamples);
+                tested.logGain (actual.getArrayOfWritePointers(), numChannels, expectedScratch, numSamples);
+
+                error = jmax (error, maxDifference (numChannels, numSamples));
+            }
+        }
+
+        return error;
+    }
+
+    float testAntiderivative()
+    {
+        auto error = 0.0;
+
+        for (auto curve : { DSPKernels::ClosedFormCurve::hard, DSPKernels::ClosedFormCurve::cubic })
+        {
+            for (int order = 1; order <= 2; ++order)
+            {
+                for (auto numSamples : lengths)
+                {
+                    fillNoise (numSamples, 3.0f);
+
+                    // the knees themselves, and the floats either side of them
+                    auto* data = input.getWritePointer (0);
+                    const float knees[] = { 1.0f, -1.0f, std::nextafter (1.0f, 2.0f), std::nextafter (-1.0f, -2.0f),
+                                            std::nextafter (1.0f, 0.0f), std::nextafter (-1.0f, 0.0f) };
+
+                    for (int i = 0; i < numSamples; i += 3)
+                        data[i] = knees[(i / 3) % numElementsInArray (knees)];
+
+                    reference.antiderivative (data, expectedAntiderivatives, numSamples, curve, order);
+                    tested.antiderivative (data, actualAntiderivatives, numSamples, curve, order);
+
+                    for (int i = 0; i < numSamples; ++i)
+                        error = jmax (error, std::abs (expectedAntiderivatives[i] - actualAntiderivatives[i]));
+                }
+            }
+        }
+
+        return (float) error;
+    }
+
+    //==============================================================================
+    float testProcessor()
+    {
+        const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+        const int blockSize = 512, numBlocks = 96, blocksPerSetting = 8;
+        auto error = 0.0f;
+
+        for (auto sampleRate : sampleRates)
+        {
+            PluginTemplateAudioProcessor expectedProcessor, actualProcessor;
+            expectedProcessor.setKernelVariant (DSPKernels::Variant::scalar);
+            actualProcessor.setKernelVariant (testedVariant);
+
+            auto numChannels = jmax (expectedProcessor.getTotalNumInputChannels(), expectedProcessor.getTotalNumOutputChannels());
+            auto numOutputs = expectedProcessor.getTotalNumOutputChannels();
+            AudioBuffer<float> expectedBlock (numChannels, blockSize), actualBlock (numChannels, blockSize);
+            MidiBuffer midi;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                if (block % blocksPerSetting == 0)
+                    setRandomParameters (expectedProcessor, actualProcessor);
+
+                // the first setting is there from the start, the rest arrive while playing and ramp
+                if (block == 0)
+                {
+                    for (auto* processor : { &expectedProcessor, &actualProcessor })
+                    {
+                        processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+                        processor->prepareToPlay (sampleRate, blockSize);
+                    }
+                }
+
+                // noise on every channel, sidechain included, in blocks of any size
+                auto numSamples = 1 + random.nextInt (blockSize);
+                expectedBlock.setSize (numChannels, numSamples, false, false, true);
+                actualBlock.setSize (numChannels, numSamples, false, false, true);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int i = 0; i < numSamples; ++i)
+                        expectedBlock.setSample (channel, i, 0.5f * (random.nextFloat() * 2.0f - 1.0f));
+
+                actualBlock.makeCopyOf (expectedBlock, true);
+                expectedProcessor.processBlock (expectedBlock, midi);
+                actualProcessor.processBlock (actualBlock, midi);
+
+                for (int channel = 0; channel < numOutputs; ++channel)
+                    error = jmax (error, maxDifference (expectedBlock.getReadPointer (channel),
+                                                        actualBlock.getReadPointer (channel), numSamples));
+            }
+
+            for (auto* processor : { &expectedProcessor, &actualProcessor })
+                processor->releaseResources();
+        }
+
+        return error;
+    }
+
+    //==============================================================================
+    struct ChainContext
+    {
+        float* const* channels;
+        int numChannels, numSamples;
+    };
+
+    struct StageCounts
+    {
+        int blocks = 0, samples = 0;
+    };
+
+    struct GainStage
+    {
+        float gain;
+        StageCounts* counts;
+
+        bool prepareBlock (ChainContext&) noexcept                  { ++counts->blocks; return gain != 1.0f; }
+        float processSample (int, int, float x) noexcept            { ++counts->samples; return x * gain; }
+    };
+
+    struct HardClipStage
+    {
+        bool active;
+        StageCounts* counts;
+
+        bool prepareBlock (ChainContext&) noexcept                  { ++counts->blocks; return active; }
+        float processSample (int, int, float x) noexcept            { ++counts->samples; return jlimit (-1.0f, 1.0f, x); }
+    };
+
+    // a block stage that depends on the order of the samples, so it would notice being fused into a run
+    struct ReverseStage
+    {
+        StageCounts* counts;
+
+        void process (ChainContext& context) noexcept
+        {
+            ++counts->blocks;
+
+            for (int channel = 0; channel < context.numChannels; ++channel)
+                std::reverse (context.channels[channel], context.channels[channel] + context.numSamples);
+        }
+    };
+
+    /** Logs one line for the chain. Returns false if the fused runs differ from the stages one by one. */
+    static bool testChain()
+    {
+        const int numChannels = 2, numSamples = 257;
+        Random random { 0xc4a1 };
+        AudioBuffer<float> input (numChannels, numSamples), expected (numChannels, numSamples), actual (numChannels, numSamples);
+        auto error = 0.0f;
+        auto skipped = true;
+
+        // with the second run's stages at rest, then with only one of them busy, then with all of them busy
+        const struct { float secondGain; bool secondClip; } cases[] = { { 1.0f, false }, { 1.0f, true }, { 0.5f, true } };
+
+        for (auto& test : cases)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < numSamples; ++i)
+                    input.setSample (channel, i, 3.0f * (random.nextFloat() * 2.0f - 1.0f));
+
+            // the reference: every stage over the whole block, one after the other
+            expected.makeCopyOf (input);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto* data = expected.getWritePointer (channel);
+
+                for (int i = 0; i < numSamples; ++i)
+                    data[i] = jlimit (-1.0f, 1.0f, data[i] * 2.0f);
+
+                std::reverse (data, data + numSamples);
+
+                for (int i = 0; i < numSamples; ++i)
+                    data[i] = data[i] * test.secondGain;
+
+                if (test.secondClip)
+                    for (int i = 0; i < numSamples; ++i)
+                        data[i] = jlimit (-1.0f, 1.0f, data[i]);
+            }
+
+            StageCounts counts[5];
+            ProcessorChain<ChainContext, GainStage, HardClipStage, ReverseStage, GainStage, HardClipStage> chain {
+                GainStage { 2.0f, &counts[0] }, HardClipStage { true, &counts[1] }, ReverseStage { &counts[2] },
+                GainStage { test.secondGain, &counts[3] }, HardClipStage { test.secondClip, &counts[4] } };
+
+            actual.makeCopyOf (input);
+            ChainContext context { actual.getArrayOfWritePointers(), numChannels, numSamples };
+            chain.process (context);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                error = jmax (error, maxDifference (expected.getReadPointer (channel), actual.getReadPointer (channel), numSamples));
+
+            // every stage is asked once; a run's samples are all visited by every stage in it, or by none
+            auto secondRunActive = test.secondGain != 1.0f || test.secondClip;
+
+            for (int stage = 0; stage < 5; ++stage)
+            {
+                auto inSecondRun = stage >= 3;
+                auto expectedSamples = stage == 2 ? 0 : (inSecondRun && ! secondRunActive ? 0 : numChannels * numSamples);
+                skipped = skipped && counts[stage].blocks == 1 && counts[stage].samples == expectedSamples;
+            }
+        }
+
+        auto ok = error == 0.0f && skipped;
+
+        Logger::writeToLog ("ProcessorChain fused runs: max error " + String (error, 9)
+                             + (skipped ? "" : ", inactive run not skipped") + (ok ? " ok" : " FAILED"));
+        return ok;
+    }
+
+    /** Gives both processors the same random setting, as if the host had automated every parameter at once. */
+    void setRandomParameters (PluginTemplateAudioProcessor& first, PluginTemplateAudioProcessor& second)
+    {
+        // linear phase is built on the message thread, batching adds latency, and the governor goes by the clock
+        const StringArray fixed { "LPFMODE", "BATCHING", "GOVERNOR" };
+
+        for (auto* parameter : first.getParameters())
+        {
+            auto* ranged = dynamic_cast<RangedAudioParameter*> (parameter);
+
+            if (ranged == nullptr)
+                continue;
+
+            auto value = fixed.contains (ranged->paramID) ? 0.0f : random.nextFloat();
+
+            for (auto* processor : { &first, &second })
+                if (auto* same = processor->apvts.getParameter (ranged->paramID))
+                    same->setValueNotifyingHost (value);
+        }
+
+        // the value tree hears about it on the message thread later; the audio thread has to know now
+        first.mustUpdateProcessing = true;
+        second.mustUpdateProcessing = true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (KernelSelfTest)
+};
@@ -0,0 +1,333 @@
+/*
+  ==============================================================================
+
+    LinearPhaseFilter.h
+
+    Linear-phase version of the low-pass stage, run as a partitioned FFT
+    overlap-save FIR whose kernel is redesigned on a background thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConvolutionEngine.h"
+#include "SharedFilterDesigns.h"
+
+//==============================================================================
+/**
+    Linear-phase low-pass with the same magnitude response as the biquad.
+
+    The kernel is designed by frequency sampling the biquad's magnitude
+    response, so switching modes changes the phase and nothing else. Designs
+    happen on a background thread: setCutoff() only stores the request and
+    wakes it. Finished kernels are handed over through a small pool of slots,
+    and the audio thread crossfades from the old kernel to the new one over
+    crossfadeBlocks partitions.
+
+    Each slot belongs to exactly one side at a time. The designer only writes
+    into slots marked released, and it hands a finished one over through
+    pendingSlot. The audio thread owns whatever it takes from there, and
+    marks a slot released again only once it has finished fading it out.
+
+    Both kernels read the same frequency-domain delay line, so a crossfade
+    costs one extra multiply-accumulate pass and inverse FFT per block.
+
+    Finished kernels come from the process-wide SharedFilterDesigns, so every
+    instance sitting on the same cutoff and rate shares one set of partition
+    spectra, and only the first one to ask pays for the design.
+*/
+class LinearPhaseLowPass  : private Thread
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr int kernelSize = 2047;     // odd, so the delay is a whole number of samples
+    static constexpr int partitionSize = 256;
+    static constexpr int crossfadeBlocks = 4;
+
+    LinearPhaseLowPass()
+        : Thread ("Linear phase designer"),
+          fft (partitionOrder), designerFFT (partitionOrder), spectrumFFT (spectrumOrder)
+    {
+        auto numPartitions = (kernelSize + partitionSize - 1) / partitionSize;
+
+        for (auto& state : states)
+        {
+            state.convolver.prepare (partitionSize, numPartitions, fft.getNumBins());
+            state.input.assign ((size_t) partitionSize, 0.0f);
+            state.output.assign ((size_t) partitionSize, 0.0f);
+            state.fadingOutput.assign ((size_t) partitionSize, 0.0f);
+        }
+    }
+
+    ~LinearPhaseLowPass() override
+    {
+        stopThread (2000);
+    }
+
+    //==============================================================================
+    /** Delay through the filter: one partition of buffering plus the kernel's centre. */
+    static constexpr int getLatencySamples() noexcept     { return partitionSize + kernelSize / 2; }
+
+    /** Designs the first kernel synchronously and starts the designer thread, so
+        call this off the audio thread, and only once the filter is actually needed.
+    */
+    void prepare (double newSampleRate, float initialCutoff)
+    {
+        stopThread (2000);
+        prepared.store (false);
+
+        sampleRate = newSampleRate;
+        requestedCutoff.store (initialCutoff);
+        design (slots[0], initialCutoff);
+        designedCutoff = initialCutoff;
+
+        // the designer thread is stopped, so every slot can be handed out afresh
+        for (int slot = 0; slot < numSlots; ++slot)
+            slots[slot].released.store (slot != 0);
+
+        activeSlot = 0;
+        fadingSlot = -1;
+        pendingSlot.store (-1);
+        reset();
+
+        startThread (3);
+        prepared.store (true, std::memory_order_release);
+    }
+
+    /** Until this is true the audio thread mustn't touch the filter at all. */
+    bool isPrepared() const noexcept    { return prepared.load (std::memory_order_acquire); }
+
+    void reset() noexcept
+    {
+        for (auto& state : states)
+        {
+            state.convolver.reset();
+            std::fill (state.input.begin(), state.input.end(), 0.0f);
+            std::fill (state.output.begin(), state.output.end(), 0.0f);
+        }
+
+        position = 0;
+    }
+
+    /** Safe to call from the audio thread: the new kernel arrives a little later. */
+    void setCutoff (float newCutoff) noexcept
+    {
+        if (requestedCutoff.exchange (newCutoff) != newCutoff)
+            notify();
+    }
+
+    //==============================================================================
+    void process (float* const* channels, int numChannels, int numSamples) noexcept
+    {
+        numChannels = jmin (numChannels, maxChannels);
+
+        for (int done = 0; done < numSamples;)
+        {
+            auto numThisTime = jmin (numSamples - done, partitionSize - position);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto& state = states[channel];
+                auto* data = channels[channel] + done;
+
+                std::copy (data, data + numThisTime, state.input.begin() + position);
+                std::copy (state.output.begin() + position, state.output.begin() + position + numThisTime, data);
+            }
+
+            done += numThisTime;
+            position += numThisTime;
+
+            if (position == partitionSize)
+            {
+                position = 0;
+                processPartition (numChannels);
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    static constexpr int partitionOrder = 9;    // 2 * partitionSize
+    static constexpr int spectrumOrder = 12;    // design grid, comfortably longer than the kernel
+    static constexpr int numSlots = 4;          // active, fading, pending and one being designed
+
+    struct Slot
+    {
+        std::shared_ptr<const ConvolutionPartitions> partitions;   // only replaced by the designer, while released
+        std::atomic<bool> released { true };                        // set by the audio thread once it's done reading
+    };
+
+    struct ChannelState
+    {
+        UniformConvolver convolver;
+        std::vector<float> input, output, fadingOutput;
+    };
+
+    RealFFT fft, designerFFT, spectrumFFT;
+    SharedResourcePointer<SharedFilterDesigns> sharedDesigns;
+    Slot slots[numSlots];
+    ChannelState states[maxChannels];
+    double sampleRate = 44100.0;
+    int position = 0, fadeBlocksLeft = 0;
+
+    int activeSlot = 0, fadingSlot = -1;        // audio thread only, apart from prepare()
+    std::atomic<int> pendingSlot { -1 };
+    std::atomic<float> requestedCutoff { 1000.0f };
+    std::atomic<bool> prepared { false };
+    float designedCutoff = 0.0f;
+
+    //==============================================================================
+    void processPartition (int numChannels) noexcept
+    {
+        // only start a new crossfade once the previous one has finished
+        if (fadingSlot < 0)
+        {
+            auto newSlot = pendingSlot.exchange (-1);
+
+            if (newSlot >= 0)
+            {
+                fadingSlot = activeSlot;
+                activeSlot = newSlot;
+                fadeBlocksLeft = crossfadeBlocks;
+            }
+        }
+
+        auto active = activeSlot;
+        auto fading = fadingSlot;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& state = states[channel];
+
+            state.convolver.pushBlock (fft, state.input.data());
+            state.convolver.computeOutput (fft, *slots[active].partitions, state.output.data());
+
+            if (fading >= 0)
+            {
+                state.convolver.computeOutput (fft, *slots[fading].partitions, state.fadingOutput.data());
+
+                auto start = (float) (crossfadeBlocks - fadeBlocksLeft) / (float) crossfadeBlocks;
+                auto step = 1.0f / (float) (crossfadeBlocks * partitionSize);
+
+                for (int i = 0; i < partitionSize; ++i)
+                {
+                    auto amount = start + step * (float) i;
+                    state.output[(size_t) i] = state.fadingOutput[(size_t) i]
+                                                 + amount * (state.output[(size_t) i] - state.fadingOutput[(size_t) i]);
+                }
+            }
+        }
+
+        // faded out: nothing reads this slot any more, so the designer may have it back
+        if (fading >= 0 && --fadeBlocksLeft == 0)
+        {
+            fadingSlot = -1;
+            slots[fading].released.store (true, std::memory_order_release);
+        }
+    }
+
+    //==============================================================================
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            wait (-1);
+
+            auto cutoff = requestedCutoff.load();
+
+            if (threadShouldExit() || cutoff == designedCutoff)
+                continue;
+
+            auto slot = claimReleasedSlot();
+
+            if (slot < 0)
+                continue;
+
+            design (slots[slot], cutoff);
+            designedCutoff = cutoff;
+
+            // a design the audio thread never picked up comes back to us, and is simply dropped
+            auto unused = pendingSlot.exchange (slot);
+
+            if (unused >= 0)
+                slots[unused].released.store (true);
+        }
+    }
+
+    int claimReleasedSlot() noexcept
+    {
+        for (int slot = 0; slot < numSlots; ++slot)
+            if (slots[slot].released.load (std::memory_order_acquire))
+            {
+                slots[slot].released.store (false);
+                return slot;
+            }
+
+        jassertfalse; // the audio thread holds at most two slots and pendingSlot one more
+        return -1;
+    }
+
+    /** Fills the slot with another instance's design for this cutoff if there
+        is one, and designs it here otherwise.
+    */
+    void design (Slot& slot, float cutoff)
+    {
+        slot.partitions = sharedDesigns->getOrDesign<ConvolutionPartitions> (SharedFilterDesigns::Type::linearPhaseLowPass,
+                                                                             sampleRate, cutoff,
+                                                                             [this, cutoff] { return designPartitions (cutoff); });
+    }
+
+    /** Frequency-samples the biquad's magnitude response, then windows the
+        zero-phase impulse down to kernelSize taps.
+    */
+    std::shared_ptr<ConvolutionPartitions> designPartitions (float cutoff)
+    {
+        using Complex = RealFFT::Complex;
+
+        auto biquad = IIRCoefficients::makeLowPass (sampleRate, jmin ((double) cutoff, sampleRate * 0.49));
+        auto* c = biquad.coefficients;
+        auto spectrumSize = spectrumFFT.getSize();
+
+        std::vector<Complex> spectrum ((size_t) spectrumFFT.getNumBins());
+        std::vector<float> impulse ((size_t) spectrumSize), kernel ((size_t) kernelSize);
+
+        for (int bin = 0; bin < spectrumFFT.getNumBins(); ++bin)
+        {
+            auto w = MathConstants<double>::twoPi * bin / spectrumSize;
+            auto z1 = std::polar (1.0, -w), z2 = std::polar (1.0, -2.0 * w);
+            auto response = ((double) c[0] + (double) c[1] * z1 + (double) c[2] * z2)
+                              / (1.0 + (double) c[3] * z1 + (double) c[4] * z2);
+
+            spectrum[(size_t) bin] = (float) std::abs (response);
+        }
+
+        spectrumFFT.inverse (spectrum.data(), impulse.data());
+
+        // centre the zero-phase response and apply a Blackman window
+        auto centre = kernelSize / 2;
+        auto sum = 0.0;
+
+        for (int i = 0; i < kernelSize; ++i)
+        {
+            auto x = (double) i / (kernelSize - 1);
+            auto window = 0.42 - 0.5 * std::cos (MathConstants<double>::twoPi * x)
+                                + 0.08 * std::cos (2.0 * MathConstants<double>::twoPi * x);
+
+            kernel[(size_t) i] = (float) (impulse[(size_t) ((i - centre + spectrumSize) % spectrumSize)] * window);
+            sum += kernel[(size_t) i];
+        }
+
+        // unity gain at DC, like the biquad
+        if (sum != 0.0)
+            for (auto& tap : kernel)
+                tap = (float) (tap / sum);
+
+        auto partitions = std::make_shared<ConvolutionPartitions>();
+        partitions->build (designerFFT, kernel.data(), kernelSize, partitionSize, 0);
+        return partitions;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseLowPass)
+};
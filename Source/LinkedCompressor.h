@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    LinkedCompressor.h
+
+    Feed-forward compressor with one detector shared by every channel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+//==============================================================================
+/**
+    Everything happens in log2 units (dB / 6.02), so the gain computer is a
+    few adds and multiplies and attack and release are plain one-poles in dB.
+
+    Each sub-block runs in three passes:
+    - the gainReduction kernel takes the loudest channel at every sample and
+      turns it into the reduction the curve asks for, with an approximate log2,
+      in vectors;
+    - attack and release follow that, one sample after another, which is the
+      only part that can't be vectorised. It's a select and a multiply-add per
+      sample, with nothing per channel;
+    - the logGain kernel turns the result back into a gain with an approximate
+      exp2 and applies it to every channel.
+
+    A block that never reaches the knee, with the envelope already at rest,
+    stops after the first pass.
+
+    Linked detection means both channels always get the same gain, so a loud
+    left side doesn't pull the image over to the right.
+*/
+class LinkedCompressor
+{
+public:
+    static constexpr float kneeDb = 6.0f;
+    static constexpr float decibelsPerLog2 = 6.0206f;      // 20 * log10 (2)
+
+    LinkedCompressor() = default;
+
+    //==============================================================================
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        setTimes (attackMs, releaseMs);
+        reset();
+    }
+
+    /** A ratio of 1 turns the compressor off; see isActive(). */
+    void setCurve (float thresholdDb, float newRatio) noexcept
+    {
+        ratio = jmax (1.0f, newRatio);
+
+        auto halfKnee = 0.5f * kneeDb / decibelsPerLog2;
+
+        curve.threshold = thresholdDb / decibelsPerLog2;
+        curve.halfKnee = halfKnee;
+        curve.kneeScale = halfKnee > 0.0f ? 0.25f / halfKnee : 0.0f;
+        curve.slope = 1.0f - 1.0f / ratio;
+    }
+
+    void setTimes (float newAttackMs, float newReleaseMs) noexcept
+    {
+        attackMs = newAttackMs;
+        releaseMs = newReleaseMs;
+
+        // per-sample one-pole coefficients
+        auto coefficientFor = [this] (float ms)
+        {
+            return (float) std::exp (-1.0 / (jmax (0.01, (double) ms) * 0.001 * sampleRate));
+        };
+
+        attackCoefficient = coefficientFor (attackMs);
+        releaseCoefficient = coefficientFor (releaseMs);
+    }
+
+    void reset() noexcept
+    {
+        envelope = 0.0f;
+    }
+
+    bool isActive() const noexcept                  { return ratio > 1.0f; }
+
+    /** How far the gain is pulled down at the end of the last block. */
+    float getGainReductionDb() const noexcept       { return envelope * decibelsPerLog2; }
+
+    //==============================================================================
+    /** scratch needs room for numSamples floats. */
+    void process (float* const* channels, int numChannels, int numSamples, float* scratch,
+                  const DSPKernels::KernelTable& k) noexcept
+    {
+        auto largest = k.gainReduction (channels, numChannels, scratch, numSamples, curve);
+
+        // nothing to reduce, and nothing left over from before: the block goes through untouched
+        if (largest <= 0.0f && envelope < restingEnvelope)
+        {
+            envelope = 0.0f;
+            return;
+        }
+
+        auto y = envelope;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto target = scratch[i];
+            auto coefficient = target > y ? attackCoefficient : releaseCoefficient;
+
+            y = target + coefficient * (y - target);
+            scratch[i] = -y;
+        }
+
+        envelope = y;
+        k.logGain (channels, numChannels, scratch, numSamples);
+    }
+
+private:
+    // about 0.0001 dB; below this the envelope is snapped to rest
+    static constexpr float restingEnvelope = 1.0e-5f;
+
+    double sampleRate = 44100.0;
+    float ratio = 1.0f;
+    float attackMs = 10.0f, releaseMs = 100.0f;
+    float attackCoefficient = 0.0f, releaseCoefficient = 0.0f;
+    float envelope = 0.0f;
+    DSPKernels::GainCurve curve { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinkedCompressor)
+};
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    MultibandCrossover.h
+
+    Linkwitz-Riley crossover into 3 to 5 bands, with a gain and a clipper in
+    every band, summed back together.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+//==============================================================================
+/**
+    The usual way to build this is a tree: split off the lowest band, split
+    what's left again, and so on, passing the lower bands through allpasses
+    so they stay in phase with the higher ones. That's a chain of dependent
+    filters, one band at a time.
+
+    The tree is linear, though, so every band is also a fixed product of
+    filters applied straight to the input:
+
+        band k = HP(f1)..HP(fk) . LP(fk+1) . AP(fk+2)..AP(fN-1)
+
+    with each HP and LP a 4th order Linkwitz-Riley (two Butterworth
+    sections) and each AP the 2nd order allpass that LP + HP add up to.
+    Written that way every band and channel is an independent chain, which
+    the splitBands kernel runs side by side in SIMD lanes. The chains are
+    padded to the longest one, 2 * (N - 1) sections.
+
+    With every band at unity gain and under the clip level the bands sum to
+    the allpass product, i.e. a flat magnitude response.
+*/
+class MultibandCrossover
+{
+public:
+    static constexpr int minBands = 3;
+    static constexpr int maxBands = 5;
+    static constexpr int maxChannels = DSPKernels::BiquadLanes::maxChannels;
+
+    static_assert (maxBands * maxChannels <= DSPKernels::BiquadLanes::numLanes, "not enough lanes for every band");
+    static_assert (2 * (maxBands - 1) <= DSPKernels::BiquadLanes::maxSections, "not enough sections for the longest chain");
+
+    MultibandCrossover()
+        : storage (new char[sizeof (DSPKernels::BiquadLanes) + laneAlignment]),
+          lanes (*new (snapPointerToAlignment (storage.get(), laneAlignment)) DSPKernels::BiquadLanes())
+    {
+    }
+
+    //==============================================================================
+    /** Turns the crossover off until setBands() is called for the new rate. */
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        numBands = 0;
+        reset();
+    }
+
+    /** Designs numBands bands split at the first numBands - 1 frequencies, lowest
+        first; 0 turns the crossover off. Doesn't allocate, but calls tan() a few
+        times, so only call it when something has changed.
+    */
+    void setBands (int newNumBands, const float* frequencies) noexcept
+    {
+        newNumBands = newNumBands == 0 ? 0 : jlimit (minBands, maxBands, newNumBands);
+
+        // a different band count puts different filters in the lanes, so old state is meaningless
+        if (newNumBands != numBands)
+        {
+            numBands = newNumBands;
+            reset();
+        }
+
+        if (numBands == 0)
+            return;
+
+        IIRCoefficients lowPass[maxBands - 1], highPass[maxBands - 1], allPass[maxBands - 1];
+        auto minFrequency = 20.0;
+
+        for (int split = 0; split < numBands - 1; ++split)
+        {
+            // kept in order, so the bands never swap over
+            auto frequency = jlimit (minFrequency, sampleRate * 0.45, (double) frequencies[split]);
+            minFrequency = frequency;
+
+            lowPass[split]  = IIRCoefficients::makeLowPass (sampleRate, frequency, butterworthQ);
+            highPass[split] = IIRCoefficients::makeHighPass (sampleRate, frequency, butterworthQ);
+            allPass[split]  = IIRCoefficients::makeAllPass (sampleRate, frequency, butterworthQ);
+        }
+
+        lanes.numSections = 2 * (numBands - 1);
+
+        for (int band = 0; band < maxBands; ++band)
+        {
+            int section = 0;
+
+            auto addSection = [&] (const float* c)
+            {
+                for (int channel = 0; channel < maxChannels; ++channel)
+                    setSection (section, band * maxChannels + channel, c);
+
+                ++section;
+            };
+
+            if (band < numBands)
+            {
+                for (int split = 0; split < band; ++split)
+                {
+                    addSection (highPass[split].coefficients);
+                    addSection (highPass[split].coefficients);
+                }
+
+                if (band < numBands - 1)
+                {
+                    addSection (lowPass[band].coefficients);
+                    addSection (lowPass[band].coefficients);
+                }
+
+                for (int split = band + 1; split < numBands - 1; ++split)
+                    addSection (allPass[split].coefficients);
+            }
+
+            // shorter chains, and bands we aren't using, pass straight through
+            static const float passThrough[5] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+            while (section < DSPKernels::BiquadLanes::maxSections)
+                addSection (passThrough);
+        }
+    }
+
+    int getNumBands() const noexcept      { return numBands; }
+
+    void reset() noexcept
+    {
+        for (int section = 0; section < DSPKernels::BiquadLanes::maxSections; ++section)
+        {
+            std::fill (std::begin (lanes.z1[section]), std::end (lanes.z1[section]), 0.0f);
+            std::fill (std::begin (lanes.z2[section]), std::end (lanes.z2[section]), 0.0f);
+        }
+    }
+
+    //==============================================================================
+    /** Splits, gains and clips every band in place. Each band's gain moves in a
+        straight line from startGains[band] to endGains[band] over the block.
+    */
+    void process (float* const* channels, int numChannels, int numSamples,
+                  const float* startGains, const float* endGains, float limit,
+                  DSPKernels::SplitBandsFunction splitBands) noexcept
+    {
+        jassert (numBands > 0 && numChannels <= maxChannels);
+
+        for (int lane = 0; lane < DSPKernels::BiquadLanes::numLanes; ++lane)
+        {
+            auto band = lane / maxChannels;
+            auto used = band < numBands;
+
+            lanes.gain[lane] = used ? startGains[band] : 0.0f;
+            lanes.increment[lane] = used && numSamples > 1 ? (endGains[band] - startGains[band]) / (float) (numSamples - 1) : 0.0f;
+        }
+
+        splitBands (lanes, channels, numChannels, numSamples, limit);
+    }
+
+private:
+    static constexpr double butterworthQ = 0.7071067811865476;
+
+    static constexpr size_t laneAlignment = 64;
+
+    // the lanes' rows are 64-byte aligned for the widest vectors, more than a plain new of
+    // whoever owns us guarantees before C++17, so they live in storage we align ourselves
+    std::unique_ptr<char[]> storage;
+    DSPKernels::BiquadLanes& lanes;
+    static_assert (alignof (DSPKernels::BiquadLanes) <= laneAlignment, "lanes need more alignment than laneAlignment");
+    double sampleRate = 44100.0;
+    int numBands = 0;
+
+    void setSection (int section, int lane, const float* c) noexcept
+    {
+        lanes.b0[section][lane] = c[0];
+        lanes.b1[section][lane] = c[1];
+        lanes.b2[section][lane] = c[2];
+        lanes.a1[section][lane] = c[3];
+        lanes.a2[section][lane] = c[4];
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultibandCrossover)
+};
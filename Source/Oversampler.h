@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    Oversampler.h
+
+    Cascaded polyphase IIR halfband oversampling, used to run the clipper at
+    a higher rate when there's CPU to spare.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    One 2x stage: two parallel chains of first-order allpass sections, fed
+    alternately (polyphase), which together form an elliptic halfband low-pass.
+    An allpass section costs one multiply, so even a steep filter is cheap.
+
+    Coefficients come from the classic design by attenuation and transition
+    bandwidth (as in Laurent de Soras' HIIR). The transition is a fraction of
+    the oversampled rate, so 0.02 keeps everything below 0.23 * that rate.
+
+    A filter keeps state for one direction only, so up- and downsampling each
+    need their own.
+*/
+class HalfbandFilter
+{
+public:
+    static constexpr int maxCoefficients = 16;
+
+    HalfbandFilter() = default;
+
+    //==============================================================================
+    /** Picks the lowest order that reaches attenuationDb, then designs it. Off the audio thread only. */
+    void design (double attenuationDb, double transition)
+    {
+        double k, q;
+        computeTransitionParameters (transition, k, q);
+
+        auto attenuation = std::pow (10.0, -attenuationDb / 10.0);
+        auto a = attenuation / (1.0 - attenuation);
+        auto order = (int) std::ceil (std::log (a * a / 16.0) / std::log (q));
+
+        if (order % 2 == 0)
+            ++order;
+
+        numCoefficients = jlimit (1, maxCoefficients, (order - 1) / 2);
+        order = numCoefficients * 2 + 1;
+
+        for (int i = 0; i < numCoefficients; ++i)
+        {
+            auto c = i + 1;
+            auto numerator = accumulateNumerator (q, order, c) * std::pow (q, 0.25);
+            auto denominator = accumulateDenominator (q, order, c) + 0.5;
+            auto ww = numerator / denominator;
+            auto wwSquared = ww * ww;
+            auto x = std::sqrt ((1.0 - wwSquared * k) * (1.0 - wwSquared / k)) / (1.0 + wwSquared);
+
+            coefficients[i] = (float) ((1.0 - x) / (1.0 + x));
+        }
+
+        reset();
+    }
+
+    int getNumCoefficients() const noexcept     { return numCoefficients; }
+
+    void reset() noexcept
+    {
+        std::fill (std::begin (x), std::end (x), 0.0f);
+        std::fill (std::begin (y), std::end (y), 0.0f);
+    }
+
+    //==============================================================================
+    /** Writes 2 * numSamples samples to output. */
+    void upsample (const float* input, float* output, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto even = input[i], odd = input[i];
+            processAllpasses (even, odd);
+
+            output[2 * i]     = even;
+            output[2 * i + 1] = odd;
+        }
+    }
+
+    /** Reads 2 * numSamples samples from input. Safe to run in place. */
+    void downsample (const float* input, float* output, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto even = input[2 * i + 1], odd = input[2 * i];
+            processAllpasses (even, odd);
+
+            output[i] = 0.5f * (even + odd);
+        }
+    }
+
+private:
+    //==============================================================================
+    float coefficients[maxCoefficients] {};
+    float x[maxCoefficients] {}, y[maxCoefficients] {};
+    int numCoefficients = 0;
+
+    // coefficients alternate between the two chains, each section running at the low rate
+    forcedinline void processAllpasses (float& even, float& odd) noexcept
+    {
+        for (int i = 0; i < numCoefficients; i += 2)
+        {
+            auto out = (even - y[i]) * coefficients[i] + x[i];
+            x[i] = even;
+            y[i] = out;
+            even = out;
+
+            if (i + 1 < numCoefficients)
+            {
+                out = (odd - y[i + 1]) * coefficients[i + 1] + x[i + 1];
+                x[i + 1] = odd;
+                y[i + 1] = out;
+                odd = out;
+            }
+        }
+    }
+
+    static void computeTransitionParameters (double transition, double& k, double& q)
+    {
+        k = std::tan ((1.0 - transition * 2.0) * MathConstants<double>::pi / 4.0);
+        k *= k;
+
+        auto kkSqrt = std::pow (1.0 - k * k, 0.25);
+        auto e = 0.5 * (1.0 - kkSqrt) / (1.0 + kkSqrt);
+        auto e4 = e * e * e * e;
+
+        q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+    }
+
+    static double accumulateNumerator (double q, int order, int c)
+    {
+        auto result = 0.0, sign = 1.0, term = 0.0;
+
+        for (int i = 0; i == 0 || std::abs (term) > 1e-100; ++i, sign = -sign)
+        {
+            term = std::pow (q, (double) (i * (i + 1))) * std::sin ((i * 2 + 1) * c * MathConstants<double>::pi / order) * sign;
+            result += term;
+        }
+
+        return result;
+    }
+
+    static double accumulateDenominator (double q, int order, int c)
+    {
+        auto result = 0.0, sign = -1.0, term = 0.0;
+
+        for (int i = 1; i == 1 || std::abs (term) > 1e-100; ++i, sign = -sign)
+        {
+            term = std::pow (q, (double) (i * i)) * std::cos (i * 2 * c * MathConstants<double>::pi / order) * sign;
+            result += term;
+        }
+
+        return result;
+    }
+};
+
+//==============================================================================
+/**
+    Up to maxStages halfband stages in series, for 2x, 4x or 8x. Every stage
+    is designed and every buffer allocated in prepare(), so changing the
+    factor with setNumStages() is free and safe on the audio thread.
+
+    The first stage does the real anti-aliasing work and gets the steep
+    filter; later stages only have to remove images far from the audio band,
+    so their transitions are wide and their filters short.
+*/
+class Oversampler
+{
+public:
+    static constexpr int maxStages = 3;
+
+    Oversampler() = default;
+
+    //==============================================================================
+    void prepare (int maxSamplesPerBlock)
+    {
+        for (int stage = 0; stage < maxStages; ++stage)
+        {
+            auto transition = stage == 0 ? 0.02 : 0.2;
+
+            up[stage].design (attenuationDb, transition);
+            down[stage].design (attenuationDb, transition);
+            buffers[stage].assign ((size_t) maxSamplesPerBlock << (stage + 1), 0.0f);
+        }
+
+        maxSamples = maxSamplesPerBlock;
+    }
+
+    /** 0 turns oversampling off; the filters are reset so nothing stale comes out. */
+    void setNumStages (int newNumStages) noexcept
+    {
+        numStages = jlimit (0, maxStages, newNumStages);
+        reset();
+    }
+
+    int getNumStages() const noexcept     { return numStages; }
+    int getFactor() const noexcept        { return 1 << numStages; }
+
+    void reset() noexcept
+    {
+        for (int stage = 0; stage < maxStages; ++stage)
+        {
+            up[stage].reset();
+            down[stage].reset();
+        }
+    }
+
+    //==============================================================================
+    /** Returns numSamples * getFactor() samples to process in place, then call downsample(). */
+    float* upsample (const float* input, int numSamples) noexcept
+    {
+        jassert (numStages > 0 && numSamples <= maxSamples);
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            up[stage].upsample (input, buffers[stage].data(), numSamples);
+            input = buffers[stage].data();
+            numSamples *= 2;
+        }
+
+        return buffers[numStages - 1].data();
+    }
+
+    void downsample (float* output, int numSamples) noexcept
+    {
+        for (int stage = numStages - 1; stage > 0; --stage)
+            down[stage].downsample (buffers[stage].data(), buffers[stage - 1].data(), numSamples << stage);
+
+        down[0].downsample (buffers[0].data(), output, numSamples);
+    }
+
+private:
+    static constexpr double attenuationDb = 110.0;
+
+    HalfbandFilter up[maxStages], down[maxStages];
+    std::vector<float> buffers[maxStages];
+    int numStages = 0, maxSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Oversampler)
+};
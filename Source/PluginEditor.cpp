@@ -37,20 +37,171 @@ PluginTemplateAudioProcessorEditor::PluginTemplateAudioProcessorEditor (PluginTe
     lpfLabel->attachToComponent(lpfSlider.get(), false);
     lpfLabel->setJustificationType(Justification::centred);
     
+    lpfModeBox = std::make_unique<ComboBox>();
+    lpfModeBox->addItemList({ "Minimum Phase", "Linear Phase" }, 1);
+    addAndMakeVisible(lpfModeBox.get());
+    lpfModeAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"LPFMODE",*lpfModeBox );
+    
+    //Sidechain
+    sidechainDepthSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(sidechainDepthSlider.get());
+    sidechainDepthAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"SCDEPTH",*sidechainDepthSlider );
+    
+    sidechainDepthLabel = std::make_unique<Label>("","SC Depth");
+    addAndMakeVisible(sidechainDepthLabel.get());
+    
+    sidechainDepthLabel->attachToComponent(sidechainDepthSlider.get(), false);
+    sidechainDepthLabel->setJustificationType(Justification::centred);
+    
+    sidechainAttackSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(sidechainAttackSlider.get());
+    sidechainAttackAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"SCATTACK",*sidechainAttackSlider );
+    
+    sidechainAttackLabel = std::make_unique<Label>("","SC Attack");
+    addAndMakeVisible(sidechainAttackLabel.get());
+    
+    sidechainAttackLabel->attachToComponent(sidechainAttackSlider.get(), false);
+    sidechainAttackLabel->setJustificationType(Justification::centred);
+    
+    sidechainReleaseSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(sidechainReleaseSlider.get());
+    sidechainReleaseAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"SCRELEASE",*sidechainReleaseSlider );
+    
+    sidechainReleaseLabel = std::make_unique<Label>("","SC Release");
+    addAndMakeVisible(sidechainReleaseLabel.get());
+    
+    sidechainReleaseLabel->attachToComponent(sidechainReleaseSlider.get(), false);
+    sidechainReleaseLabel->setJustificationType(Justification::centred);
+    
+    //Reverb
+    reverbMixSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(reverbMixSlider.get());
+    reverbMixAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"REVMIX",*reverbMixSlider );
+    
+    reverbMixLabel = std::make_unique<Label>("","Reverb");
+    addAndMakeVisible(reverbMixLabel.get());
+    
+    reverbMixLabel->attachToComponent(reverbMixSlider.get(), false);
+    reverbMixLabel->setJustificationType(Justification::centred);
+    
+    reverbDecaySlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(reverbDecaySlider.get());
+    reverbDecayAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"REVDECAY",*reverbDecaySlider );
+    
+    reverbDecayLabel = std::make_unique<Label>("","Decay");
+    addAndMakeVisible(reverbDecayLabel.get());
+    
+    reverbDecayLabel->attachToComponent(reverbDecaySlider.get(), false);
+    reverbDecayLabel->setJustificationType(Justification::centred);
+    
+    reverbDampingSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(reverbDampingSlider.get());
+    reverbDampingAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"REVDAMP",*reverbDampingSlider );
+    
+    reverbDampingLabel = std::make_unique<Label>("","Damping");
+    addAndMakeVisible(reverbDampingLabel.get());
+    
+    reverbDampingLabel->attachToComponent(reverbDampingSlider.get(), false);
+    reverbDampingLabel->setJustificationType(Justification::centred);
+    
+    //Clipper
+    shapeBox = std::make_unique<ComboBox>();
+    shapeBox->addItemList({ "Hard", "Tanh", "Cubic", "Tube" }, 1);
+    addAndMakeVisible(shapeBox.get());
+    shapeAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"SHAPE",*shapeBox );
+    
+    shapeAntialiasingBox = std::make_unique<ComboBox>();
+    shapeAntialiasingBox->addItemList({ "Off", "ADAA 1st Order", "ADAA 2nd Order" }, 1);
+    addAndMakeVisible(shapeAntialiasingBox.get());
+    shapeAntialiasingAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"SHAPEAA",*shapeAntialiasingBox );
+    
+    //CPU governor
+    governorBox = std::make_unique<ComboBox>();
+    governorBox->addItemList({ "Governor Off", "Governor On" }, 1);
+    addAndMakeVisible(governorBox.get());
+    governorAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"GOVERNOR",*governorBox );
+    
+    //Throughput mode
+    batchingBox = std::make_unique<ComboBox>();
+    batchingBox->addItemList({ "Throughput Off", "Throughput On" }, 1);
+    addAndMakeVisible(batchingBox.get());
+    batchingAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"BATCHING",*batchingBox );
+    
+    //Multiband
+    bandsBox = std::make_unique<ComboBox>();
+    bandsBox->addItemList({ "Off", "3 Bands", "4 Bands", "5 Bands" }, 1);
+    addAndMakeVisible(bandsBox.get());
+    bandsAttachment = std::make_unique<AudioProcessorValueTreeState::ComboBoxAttachment>(processor.apvts,"MBBANDS",*bandsBox );
+    
+    for (int split = 0; split < MultibandCrossover::maxBands - 1; ++split)
+    {
+        crossoverSliders[split] = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+        addAndMakeVisible(crossoverSliders[split].get());
+        crossoverAttachments[split] = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"XOVER" + String(split + 1),*crossoverSliders[split] );
+        
+        crossoverLabels[split] = std::make_unique<Label>("","Crossover " + String(split + 1));
+        addAndMakeVisible(crossoverLabels[split].get());
+        
+        crossoverLabels[split]->attachToComponent(crossoverSliders[split].get(), false);
+        crossoverLabels[split]->setJustificationType(Justification::centred);
+    }
+    
+    for (int band = 0; band < MultibandCrossover::maxBands; ++band)
+    {
+        bandGainSliders[band] = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+        addAndMakeVisible(bandGainSliders[band].get());
+        bandGainAttachments[band] = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"BAND" + String(band + 1) + "GAIN",*bandGainSliders[band] );
+        
+        bandGainLabels[band] = std::make_unique<Label>("","Band " + String(band + 1));
+        addAndMakeVisible(bandGainLabels[band].get());
+        
+        bandGainLabels[band]->attachToComponent(bandGainSliders[band].get(), false);
+        bandGainLabels[band]->setJustificationType(Justification::centred);
+    }
+    
+    //Compressor, a row of its own
+    static const char* const compressorIDs[numCompressorControls] = { "COMPTHRESH", "COMPRATIO", "COMPATTACK", "COMPRELEASE", "COMPMAKEUP" };
+    static const char* const compressorNames[numCompressorControls] = { "Threshold", "Ratio", "Attack", "Release", "Makeup" };
+    
+    for (int control = 0; control < numCompressorControls; ++control)
+    {
+        compressorSliders[control] = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+        addAndMakeVisible(compressorSliders[control].get());
+        compressorAttachments[control] = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,compressorIDs[control],*compressorSliders[control] );
+        
+        compressorLabels[control] = std::make_unique<Label>("",compressorNames[control]);
+        addAndMakeVisible(compressorLabels[control].get());
+        
+        compressorLabels[control]->attachToComponent(compressorSliders[control].get(), false);
+        compressorLabels[control]->setJustificationType(Justification::centred);
+    }
+    
+    //Convolution
+    irMixSlider = std::make_unique<Slider>(Slider::SliderStyle::RotaryVerticalDrag, Slider::TextBoxBelow);
+    addAndMakeVisible(irMixSlider.get());
+    irMixAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processor.apvts,"IRMIX",*irMixSlider );
+    
+    irMixLabel = std::make_unique<Label>("","IR Mix");
+    addAndMakeVisible(irMixLabel.get());
+    
+    irMixLabel->attachToComponent(irMixSlider.get(), false);
+    irMixLabel->setJustificationType(Justification::centred);
+    
+    impulseResponseButton = std::make_unique<TextButton>();
+    addAndMakeVisible(impulseResponseButton.get());
+    
+    impulseResponseButton->addListener(this);
+    updateImpulseResponseButton();
+    
     lookAndFeelButton = std::make_unique<TextButton>("LookAndFeel");
     addAndMakeVisible(lookAndFeelButton.get());
     
     lookAndFeelButton->addListener(this);
     
-    theLFDark.setColourScheme(LookAndFeel_V4::getDarkColourScheme());
-    theLFMid.setColourScheme(LookAndFeel_V4::getMidnightColourScheme());
-    theLFGrey.setColourScheme(LookAndFeel_V4::getGreyColourScheme());
-    theLFLight.setColourScheme(LookAndFeel_V4::getLightColourScheme());
-    
-    LookAndFeel::setDefaultLookAndFeel(&theLFDark);
+    LookAndFeel::setDefaultLookAndFeel(&getLookAndFeelFor(currentLF));
    
     Timer::startTimerHz(20);
-    setSize (400, 300);
+    setSize (500, 790);
 }
 
 PluginTemplateAudioProcessorEditor::~PluginTemplateAudioProcessorEditor()
@@ -99,6 +250,8 @@ void PluginTemplateAudioProcessorEditor::resized()
     
     recTop.reduce(10, 0);
     lookAndFeelButton->setBounds(recTop.removeFromRight(120).withSizeKeepingCentre(120, 24));
+    recTop.removeFromRight(10);
+    impulseResponseButton->setBounds(recTop.removeFromRight(120).withSizeKeepingCentre(120, 24));
     
     Grid grid;
     using Track = Grid::TrackInfo;
@@ -106,9 +259,35 @@ void PluginTemplateAudioProcessorEditor::resized()
     
     grid.items.add(GridItem(volumeSlider.get()));
     grid.items.add(GridItem(lpfSlider.get()));
+    grid.items.add(GridItem(irMixSlider.get()));
+    grid.items.add(GridItem(lpfModeBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
+    grid.items.add(GridItem(sidechainDepthSlider.get()));
+    grid.items.add(GridItem(sidechainAttackSlider.get()));
+    grid.items.add(GridItem(sidechainReleaseSlider.get()));
+    grid.items.add(GridItem(shapeBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
+    grid.items.add(GridItem(shapeAntialiasingBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
+    grid.items.add(GridItem(governorBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
+    
+    for (auto& slider : compressorSliders)
+        grid.items.add(GridItem(slider.get()));
+    
+    //multiband on rows of its own, band count first
+    
+    grid.items.add(GridItem(bandsBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
+    
+    for (auto& slider : crossoverSliders)
+        grid.items.add(GridItem(slider.get()));
+    
+    for (auto& slider : bandGainSliders)
+        grid.items.add(GridItem(slider.get()));
+    
+    grid.items.add(GridItem(reverbMixSlider.get()));
+    grid.items.add(GridItem(reverbDecaySlider.get()));
+    grid.items.add(GridItem(reverbDampingSlider.get()));
+    grid.items.add(GridItem(batchingBox.get()).withHeight(24.0f).withAlignSelf(GridItem::AlignSelf::center));
     
     grid.templateColumns = { Track (Fr (1)), Track (Fr (1)), Track (Fr (1)), Track (Fr (1)), Track (Fr (1)) };
-    grid.templateRows = {Track (Fr (1)), Track (Fr (1)) };
+    grid.templateRows = {Track (Fr (1)), Track (Fr (1)), Track (Fr (1)), Track (Fr (1)), Track (Fr (1)), Track (Fr (1)) };
     grid.columnGap = Grid::Px (10);
     grid.rowGap = Grid::Px (10);
     
@@ -118,6 +297,37 @@ void PluginTemplateAudioProcessorEditor::resized()
 
 void PluginTemplateAudioProcessorEditor::buttonClicked(Button* button)
 {
+    if (button == impulseResponseButton.get())
+    {
+        PopupMenu m;
+        
+        m.addItem(1,"Load Impulse Response...");
+        m.addItem(2,"Clear Impulse Response", processor.getImpulseResponseName().isNotEmpty());
+        
+        auto result = m.showAt(impulseResponseButton.get());
+        
+        if (result == 1)
+        {
+            impulseResponseChooser = std::make_unique<FileChooser>("Load Impulse Response", File(), "*.wav;*.aif;*.aiff;*.flac");
+            
+            impulseResponseChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles,
+                                                [this] (const FileChooser& chooser)
+                                                {
+                                                    auto file = chooser.getResult();
+                                                    
+                                                    if (file.existsAsFile())
+                                                        processor.loadImpulseResponse(file);
+                                                    
+                                                    updateImpulseResponseButton();
+                                                });
+        }
+        else if (result == 2)
+        {
+            processor.clearImpulseResponse();
+            updateImpulseResponseButton();
+        }
+    }
+    
     if (button == lookAndFeelButton.get())
     {
         PopupMenu m;
@@ -129,30 +339,15 @@ void PluginTemplateAudioProcessorEditor::buttonClicked(Button* button)
         
         m.addSeparator();
         m.addItem(5,"JUCE 4 Look and Feel", true,currentLF==5);
-        m.addItem(5,"JUCE 3 Look and Feel", true,currentLF==6);
+        m.addItem(6,"JUCE 3 Look and Feel", true,currentLF==6);
         
         auto result = m.showAt(lookAndFeelButton.get());
         
-        if (result == 1)
-        LookAndFeel::setDefaultLookAndFeel(&theLFDark);
-        
-        else if (result == 2)
-        LookAndFeel::setDefaultLookAndFeel(&theLFMid);
-        
-        else if (result == 3)
-        LookAndFeel::setDefaultLookAndFeel(&theLFGrey);
-        
-        else if (result == 4)
-        LookAndFeel::setDefaultLookAndFeel(&theLFLight);
-        
-        else if (result == 5)
-        LookAndFeel::setDefaultLookAndFeel(&theLFV2);
-        
-        else if (result == 6)
-        LookAndFeel::setDefaultLookAndFeel(&theLFV3);
-            
-        if(result != 0)
-        currentLF = result;
+        if (result != 0)
+        {
+            LookAndFeel::setDefaultLookAndFeel(&getLookAndFeelFor(result));
+            currentLF = result;
+        }
 
         
         
@@ -161,6 +356,12 @@ void PluginTemplateAudioProcessorEditor::buttonClicked(Button* button)
 
 void PluginTemplateAudioProcessorEditor::timerCallback()
 {
+    //once the governor has stepped in, the meter gives back its share of the CPU too
+    auto rate = processor.governorLevel.load() > 0 ? 10 : 20;
+    
+    if (getTimerInterval() != 1000 / rate)
+        Timer::startTimerHz(rate);
+    
     repaint(); 
 }
 
@@ -175,3 +376,28 @@ void PluginTemplateAudioProcessorEditor::mouseDown (const MouseEvent& e)
         processor.meterGlobalMaxVal.store (0.0f);
 }
 
+LookAndFeel& PluginTemplateAudioProcessorEditor::getLookAndFeelFor(int choice)
+{
+    auto& lookAndFeel = lookAndFeels[choice - 1];
+    
+    if (lookAndFeel == nullptr)
+    {
+        switch (choice)
+        {
+            case 1:  lookAndFeel = std::make_unique<LookAndFeel_V4>(LookAndFeel_V4::getDarkColourScheme()); break;
+            case 2:  lookAndFeel = std::make_unique<LookAndFeel_V4>(LookAndFeel_V4::getMidnightColourScheme()); break;
+            case 3:  lookAndFeel = std::make_unique<LookAndFeel_V4>(LookAndFeel_V4::getGreyColourScheme()); break;
+            case 4:  lookAndFeel = std::make_unique<LookAndFeel_V4>(LookAndFeel_V4::getLightColourScheme()); break;
+            case 5:  lookAndFeel = std::make_unique<LookAndFeel_V2>(); break;
+            default: lookAndFeel = std::make_unique<LookAndFeel_V3>(); break;
+        }
+    }
+    
+    return *lookAndFeel;
+}
+
+void PluginTemplateAudioProcessorEditor::updateImpulseResponseButton()
+{
+    auto name = processor.getImpulseResponseName();
+    impulseResponseButton->setButtonText(name.isNotEmpty() ? name : "No IR");
+}
@@ -34,16 +34,41 @@ private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     
-    std::unique_ptr<Slider> volumeSlider, lpfSlider;
-    std::unique_ptr<Label> volumeLabel, lpfLabel;
-    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> volumeAttachment, lpfAttachment;
-    std::unique_ptr<TextButton> lookAndFeelButton;
+    std::unique_ptr<Slider> volumeSlider, lpfSlider, irMixSlider;
+    std::unique_ptr<Label> volumeLabel, lpfLabel, irMixLabel;
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> volumeAttachment, lpfAttachment, irMixAttachment;
+    std::unique_ptr<Slider> sidechainDepthSlider, sidechainAttackSlider, sidechainReleaseSlider;
+    std::unique_ptr<Label> sidechainDepthLabel, sidechainAttackLabel, sidechainReleaseLabel;
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> sidechainDepthAttachment, sidechainAttackAttachment, sidechainReleaseAttachment;
+    std::unique_ptr<ComboBox> lpfModeBox;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> lpfModeAttachment;
+    std::unique_ptr<Slider> reverbMixSlider, reverbDecaySlider, reverbDampingSlider;
+    std::unique_ptr<Label> reverbMixLabel, reverbDecayLabel, reverbDampingLabel;
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> reverbMixAttachment, reverbDecayAttachment, reverbDampingAttachment;
+    std::unique_ptr<ComboBox> shapeBox, shapeAntialiasingBox;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> shapeAttachment, shapeAntialiasingAttachment;
+    std::unique_ptr<ComboBox> governorBox, batchingBox;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> governorAttachment, batchingAttachment;
+    static constexpr int numCompressorControls = 5;
+    std::unique_ptr<Slider> compressorSliders[numCompressorControls];
+    std::unique_ptr<Label> compressorLabels[numCompressorControls];
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> compressorAttachments[numCompressorControls];
+    std::unique_ptr<ComboBox> bandsBox;
+    std::unique_ptr<AudioProcessorValueTreeState::ComboBoxAttachment> bandsAttachment;
+    std::unique_ptr<Slider> crossoverSliders[MultibandCrossover::maxBands - 1], bandGainSliders[MultibandCrossover::maxBands];
+    std::unique_ptr<Label> crossoverLabels[MultibandCrossover::maxBands - 1], bandGainLabels[MultibandCrossover::maxBands];
+    std::unique_ptr<AudioProcessorValueTreeState::SliderAttachment> crossoverAttachments[MultibandCrossover::maxBands - 1], bandGainAttachments[MultibandCrossover::maxBands];
+    std::unique_ptr<TextButton> lookAndFeelButton, impulseResponseButton;
+    std::unique_ptr<FileChooser> impulseResponseChooser;
     
-    LookAndFeel_V4 theLFDark, theLFMid, theLFGrey, theLFLight;
-    LookAndFeel_V3 theLFV3;
-    LookAndFeel_V2 theLFV2;
+    void updateImpulseResponseButton();
+    
+    //each one is only built the first time it's picked, so opening the editor costs just the dark one
+    std::unique_ptr<LookAndFeel> lookAndFeels[6];
     int currentLF = { 1 };
     
+    LookAndFeel& getLookAndFeelFor(int choice);
+    
      
     PluginTemplateAudioProcessor& processor;
 
@@ -16,6 +16,7 @@ PluginTemplateAudioProcessor::PluginTemplateAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
@@ -23,6 +24,19 @@ PluginTemplateAudioProcessor::PluginTemplateAudioProcessor()
 #endif
 {
     apvts.state.addListener(this);
+    kernelVariant.store(DSPKernels::getVariantFromEnvironment());
+    
+    //the flight recorder watches every parameter, so find them all once up front
+    for (auto* parameter : getParameters())
+    {
+        if (auto* ranged = dynamic_cast<RangedAudioParameter*>(parameter))
+        {
+            recordedParameterNames.add(ranged->paramID);
+            recordedParameters.push_back(apvts.getRawParameterValue(ranged->paramID));
+        }
+    }
+    
+    lastRecordedValues.assign(recordedParameters.size(), std::numeric_limits<float>::quiet_NaN());
     init();
 }
 
@@ -65,7 +79,7 @@ bool PluginTemplateAudioProcessor::isMidiEffect() const
 
 double PluginTemplateAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return jmax(convolutionTailSeconds.load(), reverbTailSeconds.load());
 }
 
 int PluginTemplateAudioProcessor::getNumPrograms()
@@ -124,6 +138,17 @@ bool PluginTemplateAudioProcessor::isBusesLayoutSupported (const BusesLayout& la
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    //the sidechain can be off, mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -138,69 +163,377 @@ void PluginTemplateAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
         return;
     }
     
+    //throughput mode: most host calls only swap samples with the batcher, and the chain runs once per full batch
+    if (batchingEnabled)
+        batcher.process(buffer, [this] (AudioBuffer<float>& batch) { processInternal(batch); });
+    else
+        processInternal(buffer);
+    
+    //a mode switch is picked up inside processInternal, maybe halfway through batcher.process,
+    //so the batches are only cleared once it has returned
+    if (batcherNeedsReset)
+    {
+        batcher.reset();
+        batcherNeedsReset = false;
+    }
+}
+
+void PluginTemplateAudioProcessor::processInternal (AudioBuffer<float>& buffer)
+{
+    //the parameter update, meters, flight recorder and governor all run here, once per batch in throughput mode
+    auto blockStartTicks = Time::getHighResolutionTicks();
+    flightRecorder.recordAt(FlightRecorder::EventType::blockStart, blockStartTicks, buffer.getNumSamples());
+    
     if (mustUpdateProcessing)
     {
         update();
     }
     
+    updateFilterLatency();
     
     juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    
+    //hosts can flip to offline rendering between any two blocks
+    auto profile = isNonRealtime() ? QualityProfile::offline : QualityProfile::realtime;
+    
+    if (profile != qualityProfile)
+        setQualityProfile(profile);
+    
+    //the sidechain's channels come after the main input's, so only count the main bus here
+    auto totalNumInputChannels  = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
     auto numSamples = buffer.getNumSamples();
-    auto numChannels = jmin(totalNumInputChannels, totalNumOutputChannels);
+    auto numChannels = jmin(totalNumInputChannels, totalNumOutputChannels, SubBlockEngine::maxChannels);
 
-    auto sumMaxVal = 0.0f;
-    auto currentMaxVal = meterGlobalMaxVal.load();
+    float channelMaxVal[SubBlockEngine::maxChannels] = {};
+    auto startMaxVal = meterGlobalMaxVal.load();
+    auto currentMaxVal = startMaxVal;
     
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, numSamples);
     
-//    outputVolume.applyGain(buffer, buffer.getNumSamples());
+    //if the message thread is swapping in a new impulse response, skip the convolution for this block
+    const SpinLock::ScopedTryLockType convolutionTryLock (convolutionLock);
+    auto* convolutionEngine = convolutionTryLock.isLocked() ? convolution.get() : nullptr;
+    
+    //the sidechain only costs anything when it's connected and has somewhere to go
+    auto numSidechainChannels = 0;
+    
+    if (sidechainDepth != 0.0f && getBusCount(true) > 1 && getBus(true, 1)->isEnabled())
+        numSidechainChannels = jmin(getBus(true, 1)->getNumberOfChannels(), SubBlockEngine::maxChannels);
+    
+    //sidechain unplugged or depth back at zero: return to the exact, unmodulated coefficients
+    if (numSidechainChannels == 0 && cutoffIsModulated)
+    {
+        sidechainFollower.reset();
+        
+        //a cutoff that's still moving gets there by itself
+        if (! smoothing.isSmoothing(cutoffSmoothing))
+            setExactCutoff();
+    }
+    
+    auto firstSidechainChannel = numSidechainChannels > 0 ? getChannelIndexInProcessBlockBuffer(true, 1, 0) : 0;
+    const float* sidechain[SubBlockEngine::maxChannels] = {};
+    auto offset = 0;
+    
+    //the host decides the buffer size, we decide how much we chew on at once
+    subBlockEngine.process(buffer, numChannels, [&] (float* const* channels, int numChannelsInBlock, int numSamplesInBlock)
+    {
+        for (int channel = 0; channel < numSidechainChannels; ++channel)
+            sidechain[channel] = buffer.getReadPointer(firstSidechainChannel + channel, offset);
+        
+        processSubBlock(channels, numChannelsInBlock, numSamplesInBlock, sidechain, numSidechainChannels,
+                        convolutionEngine, channelMaxVal, currentMaxVal);
+        offset += numSamplesInBlock;
+    });
+    
+    //only if nobody clicked the meter to reset it while this block ran
+    meterGlobalMaxVal.compare_exchange_strong(startMaxVal, currentMaxVal);
+    
+    auto sumMaxVal = 0.0f;
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        sumMaxVal += channelMaxVal[channel];//sum of ch 0 and  ch 1  max vals
+    
+    if (numChannels > 0)
+        meterLocalMaxVal.store (sumMaxVal/(float)numChannels) ; //numChannels
+    
+    //flight recorder: what clipped, whether anything went subnormal, and whether we were on time
+    if (clippedChannels > 0)
+        flightRecorder.record(FlightRecorder::EventType::clip, clippedChannels, blockPeak);
+    
+    clippedChannels = 0;
+    blockPeak = 0.0f;
+    
+    //FTZ is on and the biquad snaps its state, so this should never fire
+    auto numDenormals = 0;
+    
+    for (auto& state : filter->z)
+        for (auto value : state)
+            numDenormals += std::fpclassify(value) == FP_SUBNORMAL ? 1 : 0;
+    
+    if (numDenormals > 0)
+        flightRecorder.record(FlightRecorder::EventType::denormals, numDenormals);
+    
+    auto blockEndTicks = Time::getHighResolutionTicks();
+    flightRecorder.recordAt(FlightRecorder::EventType::blockEnd, blockEndTicks, numSamples);
+    
+    //offline renders have no deadline to miss
+    auto deadline = deadlineTicksPerSample * numSamples;
+    auto realtimeDeadline = ! isNonRealtime() && deadline > 0;
+    
+    //the governor's own changes happen after the clock stops, and show up from the next block on
+    if (governorEnabled && realtimeDeadline
+         && cpuGovernor.addBlock((float) (blockEndTicks - blockStartTicks) / (float) deadline, numSamples))
+        applyGovernorLevel();
+    
+    if (realtimeDeadline && blockEndTicks - blockStartTicks > deadline)
+    {
+        flightRecorder.recordAt(FlightRecorder::EventType::xrun, blockEndTicks,
+                                0, (float) (blockEndTicks - blockStartTicks) / (float) deadline);
+        
+        flightRecordingRequested.store(true);
+        triggerAsyncUpdate();
+    }
+}
+
+void PluginTemplateAudioProcessor::processSubBlock (float* const* channels, int numChannels, int numSamples,
+                                                    const float* const* sidechain, int numSidechainChannels,
+                                                    ConvolutionEngine* convolutionEngine,
+                                                    float* channelMaxVal, float& currentMaxVal)
+{
+    //every smoothed parameter's ramp for this sub-block, computed once for all channels
+    smoothing.process(numSamples);
+    
+    SubBlockContext context { channels, numChannels, numSamples, sidechain, numSidechainChannels,
+                              convolutionEngine, channelMaxVal, currentMaxVal, *kernels.load(), {} };
+    
+    //the stages run in the order they're listed in the chain's type
+    chain.process(context);
+}
 
+void PluginTemplateAudioProcessor::filterSubBlock (SubBlockContext& context) noexcept
+{
+    auto& k = context.kernels;
+    auto* channels = context.channels;
+    auto numChannels = context.numChannels;
+    auto numSamples = context.numSamples;
+    auto numSidechainChannels = context.numSidechainChannels;
+    
+    auto cutoffMoving = smoothing.isRamping(cutoffSmoothing);
     
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    //until the message thread has built the linear phase filter, the biquad stands in for it
+    auto linearPhase = linearPhaseLive;
+    
+    //the biquad runs even fully open: at 20 kHz it still rolls off the top, and its state must be live when the cutoff comes down
+    //with a sidechain or a moving cutoff the biquad runs in control-rate segments, with the cutoff moved in between
+    for (int done = 0; done < numSamples;)
     {
-        auto* channelData = buffer.getWritePointer (channel);
+        auto numThisTime = numSamples - done;
+        
+        if (numSidechainChannels > 0)
+            numThisTime = jmin(numThisTime, sidechainFollower.getSamplesUntilUpdate());
+        else if (cutoffMoving)
+            numThisTime = jmin(numThisTime, sidechainFollower.getControlInterval());
+        
+        if (! linearPhase)
+            for (int channel = 0; channel < numChannels; ++channel)
+                k.biquad(channels[channel] + done, numThisTime, filter->coefficients, filter->z[channel]);
         
-        auto channelMaxVal = 0.0f;
+        auto controlTick = cutoffMoving;
+        
+        if (numSidechainChannels > 0)
+        {
+            const float* segment[SubBlockEngine::maxChannels] = {};
             
-        iirFilter[channel].processSamples(channelData, numSamples);
+            for (int channel = 0; channel < numSidechainChannels; ++channel)
+                segment[channel] = context.sidechain[channel] + done;
+            
+            controlTick = sidechainFollower.process(segment, numSidechainChannels, numThisTime, k.peak);
+        }
+        
+        if (controlTick)
+            applyModulatedCutoff(smoothing.getValueAt(cutoffSmoothing, done + numThisTime - 1));
+        
+        done += numThisTime;
+    }
+    
+    //the cutoff just arrived, so back to exact coefficients
+    if (cutoffMoving && ! smoothing.isSmoothing(cutoffSmoothing) && numSidechainChannels == 0)
+        setExactCutoff();
+    
+    if (linearPhase)
+        linearPhaseFilter.process(channels, numChannels, numSamples);
+}
+
+void PluginTemplateAudioProcessor::compressorSubBlock (SubBlockContext& context) noexcept
+{
+    //compressor: at 1:1 it's out of the way, and starts again from no reduction
+    if (! compressor.isActive())
+    {
+        compressor.reset();
+        return;
+    }
+    
+    //the detector's reduction and then the gain go through the first channel's scratch, shared by both channels
+    compressor.process(context.channels, context.numChannels, context.numSamples,
+                       subBlockEngine.getScratch(gainScratch, 0), context.kernels);
+}
+
+void PluginTemplateAudioProcessor::reverbSubBlock (SubBlockContext& context) noexcept
+{
+    //reverb, added on top of the filtered signal like a send
+    if (smoothing.isRamping(reverbMixSmoothing) || smoothing.getCurrentValue(reverbMixSmoothing) > 0.0f)
+    {
+        if (! reverbRunning)
+        {
+            reverb.reset();
+            reverbRunning = true;
+        }
         
-        outputVolume[channel].applyGain(channelData,numSamples);
+        reverb.process(context.channels, context.numChannels, context.numSamples,
+                       smoothing.isRamping(reverbMixSmoothing) ? smoothing.getRamp(reverbMixSmoothing) : nullptr,
+                       smoothing.getCurrentValue(reverbMixSmoothing));
+    }
+    else
+    {
+        reverbRunning = false;
+    }
+}
+
+void PluginTemplateAudioProcessor::convolutionSubBlock (SubBlockContext& context) noexcept
+{
+    auto* convolutionEngine = context.convolutionEngine;
+    auto* channels = context.channels;
+    auto numChannels = context.numChannels;
+    auto numSamples = context.numSamples;
+    
+    if (convolutionEngine == nullptr)
+        return;
+    
+    for (int channel = 0; channel < numChannels; ++channel)
+        FloatVectorOperations::copy(subBlockEngine.getScratch(dryScratch, channel), channels[channel], numSamples);
+    
+    //offline, the tail is worked out in line rather than dropped when the render outruns its thread
+    convolutionEngine->setSynchronousTail(qualityProfile == QualityProfile::offline);
+    convolutionEngine->process(channels, numChannels, numSamples);
+    
+    //dry/wet: out = dry + mix * (wet - dry)
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* dry = subBlockEngine.getScratch(dryScratch, channel);
+        auto* wet = channels[channel];
+        
+        FloatVectorOperations::subtract(wet, dry, numSamples);
+        
+        if (smoothing.isRamping(mixSmoothing))
+            FloatVectorOperations::multiply(wet, smoothing.getRamp(mixSmoothing), numSamples);
+        else
+            FloatVectorOperations::multiply(wet, smoothing.getCurrentValue(mixSmoothing), numSamples);
         
+        FloatVectorOperations::add(wet, dry, numSamples);
+    }
+}
+
+void PluginTemplateAudioProcessor::multibandSubBlock (SubBlockContext& context) noexcept
+{
+    //multiband: every band gained and clipped on its own, then summed back before the master volume and clipper
+    if (multiband.getNumBands() == 0)
+        return;
+    
+    auto numSamples = context.numSamples;
+    float startGains[MultibandCrossover::maxBands], endGains[MultibandCrossover::maxBands];
+    
+    for (int band = 0; band < MultibandCrossover::maxBands; ++band)
+    {
+        startGains[band] = smoothing.getValueAt(bandGainSmoothing + band, 0);
+        endGains[band] = smoothing.getValueAt(bandGainSmoothing + band, numSamples - 1);
+    }
+    
+    multiband.process(context.channels, jmin(context.numChannels, MultibandCrossover::maxChannels), numSamples,
+                      startGains, endGains, 1.0f, context.kernels.splitBands);
+}
+
+void PluginTemplateAudioProcessor::volumeSubBlock (SubBlockContext& context) noexcept
+{
+    //the shared volume ramp while it moves, a plain constant gain at rest
+    if (smoothing.isRamping(volumeSmoothing))
+    {
+        for (int channel = 0; channel < context.numChannels; ++channel)
+            FloatVectorOperations::multiply(context.channels[channel], smoothing.getRamp(volumeSmoothing), context.numSamples);
+        
+        return;
+    }
+    
+    //0 dB at rest leaves the block alone
+    auto gain = smoothing.getCurrentValue(volumeSmoothing);
+    
+    if (gain == 1.0f)
+        return;
+    
+    for (int channel = 0; channel < context.numChannels; ++channel)
+        context.kernels.gainRamp(context.channels[channel], context.numSamples, gain, 0.0f);
+}
+
+void PluginTemplateAudioProcessor::meterSubBlock (SubBlockContext& context) noexcept
+{
+    for (int channel = 0; channel < context.numChannels; ++channel)
+    {
         //absolute value of all samples in a buffer
         //is the current sample larger than our current max?
             //if yes -- channelaxVal = new max
+        auto rectifiedVal = context.kernels.peak(context.channels[channel], context.numSamples);
+        context.channelPeaks[channel] = rectifiedVal;
         
-        for (int sample = 0; sample < numSamples; ++sample)
+        if (context.channelMaxVal[channel] < rectifiedVal)
+            context.channelMaxVal[channel] = rectifiedVal;
+        
+        if (rectifiedVal > 1.0f)
         {
-            auto rectifiedVal = std::abs(channelData[sample]);
-            
-            if (channelMaxVal < rectifiedVal)
-                channelMaxVal = rectifiedVal;
-            
-            if (currentMaxVal< rectifiedVal)
-                currentMaxVal=rectifiedVal;
+            ++clippedChannels;
+            blockPeak = jmax(blockPeak, rectifiedVal);
         }
         
-            sumMaxVal += channelMaxVal;//sum of ch 0 and  ch 1  max vals
+        if (context.currentMaxVal< rectifiedVal)
+            context.currentMaxVal=rectifiedVal;
+    }
+}
+
+void PluginTemplateAudioProcessor::clipSubBlock (SubBlockContext& context) noexcept
+{
+    auto& k = context.kernels;
+    auto numSamples = context.numSamples;
+    
+    for (int channel = 0; channel < context.numChannels; ++channel)
+    {
+        auto* channelData = context.channels[channel];
         
-            meterGlobalMaxVal.store(currentMaxVal);
-//        ignoreUnused(channelData);
+        //clipper, oversampled when there's time for it so the harmonics it adds don't alias
+        auto& oversampler = clipOversampler[channel];
+        auto& shaper = clipShaper[channel];
         
+        //nothing over the limit and nothing else in the way: a hard clip would leave it as it is
+        if (shaper.isHardClipOnly() && oversampler.getNumStages() == 0 && context.channelPeaks[channel] <= 1.0f)
+            continue;
         
-        for (int sample = 0; sample < numSamples; ++sample)
+        auto clip = [&] (float* data, int numSamplesToClip)
         {
-//            channelData[sample] *=  outputVolume;
-            
-            //iterate hard clipper values
-            channelData[sample] = jlimit(-1.0f, 1.0f, channelData[sample]);
-            
+            if (shaper.isHardClipOnly())
+                k.clip(data, numSamplesToClip, 1.0f);
+            else
+                shaper.process(data, numSamplesToClip, k);
+        };
+        
+        if (oversampler.getNumStages() > 0)
+        {
+            clip(oversampler.upsample(channelData, numSamples), numSamples * oversampler.getFactor());
+            oversampler.downsample(channelData, numSamples);
+        }
+        else
+        {
+            clip(channelData, numSamples);
         }
     }
-    
-    meterLocalMaxVal.store (sumMaxVal/(float)numChannels) ; //numChannels
 }
 
 //==============================================================================
@@ -227,6 +560,14 @@ void PluginTemplateAudioProcessor::setStateInformation (const void* data, int si
     std::unique_ptr<XmlElement> xml = getXmlFromBinary(data, sizeInBytes);
     ValueTree copyState = ValueTree::fromXml(*xml.get());
     apvts.replaceState(copyState);
+    
+    //the impulse response itself isn't stored, only where to find it
+    auto irPath = apvts.state.getProperty("IRFile").toString();
+    
+    if (irPath.isNotEmpty())
+        loadImpulseResponse(File(irPath));
+    else
+        clearImpulseResponse();
 }
 
 //==============================================================================
@@ -242,42 +583,360 @@ void PluginTemplateAudioProcessor::init()
 {
     //Called Once; Give Initial Values to DSP
     
+    //in the order of SmoothedParameters; volume is smoothed as a gain, in equal ratios
+    smoothing.addParameter(SmoothingEngine::Curve::multiplicative, 0.050, 1.0f);
+    smoothing.addParameter(SmoothingEngine::Curve::linear, 0.050, 1.0f);
+    smoothing.addParameter(SmoothingEngine::Curve::onePole, 0.050, 800.0f);    //follows a dragged knob without kinks
+    smoothing.addParameter(SmoothingEngine::Curve::linear, 0.050, 0.0f);
+    
+    for (int band = 0; band < MultibandCrossover::maxBands; ++band)
+        smoothing.addParameter(SmoothingEngine::Curve::multiplicative, 0.050, 1.0f);
 }
     
 void PluginTemplateAudioProcessor::prepare(double sampleRate, int samplesPerBlock)
 {
   //Pass Sample Rate and Buffer Size to DSP
+    //CPU features are checked the first time round, after that this just looks the table up
+    kernels.store(&DSPKernels::getKernels(kernelVariant.load()));
+    flightRecorder.prepare();
+    
+    linearPhaseMode = apvts.getRawParameterValue("LPFMODE")->load() > 0.5f;
+    batchingEnabled = apvts.getRawParameterValue("BATCHING")->load() > 0.5f;
+    batchLatency.store(batchingEnabled ? BlockBatcher::getLatencySamples() : 0);
+    
+    //throughput mode hands the chain whole batches, however small the host's blocks are
+    samplesPerBlock = jmax(samplesPerBlock, BlockBatcher::batchSize);
+    
+    //the batches carry every channel of the process buffer, and the layout can change without the rate or block size
+    auto numBufferChannels = jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    
+    if (batcher.getNumChannels() != numBufferChannels)
+        batcher.prepare(numBufferChannels);
+    
+    //hosts call prepareToPlay again with the same settings all the time; only a new rate or block size rebuilds anything
+    if (sampleRate != preparedSampleRate || samplesPerBlock != preparedBlockSize)
+    {
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = samplesPerBlock;
+        
+        //every scratch buffer, ramp and filter state is laid out here in one go, never on the audio thread
+        auto subBlockSize = SubBlockEngine::getSubBlockSizeFor(samplesPerBlock);
+        
+        stateArena.prepare({ SubBlockEngine::getScratchSize(samplesPerBlock, numScratchBuffers),
+                             smoothing.getRampStorageSize(subBlockSize),
+                             sizeof(FilterState) / sizeof(float) });
+        
+        subBlockEngine.prepare(SubBlockEngine::maxChannels, samplesPerBlock, numScratchBuffers, stateArena.getRegion(scratchRegion));
+        smoothing.prepare(sampleRate, subBlockSize, stateArena.getRegion(rampRegion));
+        filter = new (stateArena.getRegion(filterRegion)) FilterState();
+        
+        //the first instance at this rate builds the table, the rest just take a reference to it
+        cutoffTable = sharedDesigns->getOrDesign<LowPassCoefficientTable>(SharedFilterDesigns::Type::lowPassTable, sampleRate, 0.0f, [sampleRate]
+        {
+            auto table = std::make_shared<LowPassCoefficientTable>();
+            table->prepare(sampleRate);
+            return table;
+        });
+        sidechainFollower.prepare(sampleRate);
+        compressor.prepare(sampleRate);
+        cpuGovernor.prepare(sampleRate);
+        multiband.prepare(sampleRate);      //off until update designs the bands for this rate
+        reverb.prepare(sampleRate, subBlockEngine.getSubBlockSize());
+        
+        //both quality profiles are sized up front, whichever one we start in
+        for (auto& oversampler : clipOversampler)
+            oversampler.prepare(subBlockEngine.getSubBlockSize());
+        
+        //the shaper may run inside the oversampler, so it gets room for the largest factor
+        for (auto& shaper : clipShaper)
+            shaper.prepare(subBlockEngine.getSubBlockSize() << Oversampler::maxStages);
+        
+        //a block of n samples has n sample periods to finish in
+        deadlineTicksPerSample = Time::getHighResolutionTicksPerSecond() / (int64) sampleRate;
+        
+        //a filter built for the old rate is rebuilt now; one that was never needed is still left for later
+        if (linearPhaseFilter.isPrepared())
+            linearPhaseFilter.prepare(sampleRate, apvts.getRawParameterValue("LPF")->load());
+    }
+    
+    setQualityProfile(isNonRealtime() ? QualityProfile::offline : QualityProfile::realtime);
+    
+    //the linear phase filter's kernel design and thread only exist once someone picks it
+    if (linearPhaseMode && ! linearPhaseFilter.isPrepared())
+        linearPhaseFilter.prepare(sampleRate, apvts.getRawParameterValue("LPF")->load());
+    
+    //the linear phase filter is built by now if it was picked, so the host hears the latency it'll really get
+    linearPhaseLive = linearPhaseMode && linearPhaseFilter.isPrepared();
+    filterLatency.store(linearPhaseLive ? LinearPhaseLowPass::getLatencySamples() : 0);
+    setLatencySamples(filterLatency.load() + batchLatency.load());
+    
+    //the impulse response is resampled to the processing rate, so a new rate means a new engine
+    if (sampleRate != convolutionSampleRate)
+        rebuildConvolution();
 }
 void PluginTemplateAudioProcessor::update()
 {
     mustUpdateProcessing = false;
+    flightRecorder.record(FlightRecorder::EventType::update);
+    recordParameterChanges();
+    
     //Update DSP when a user changes parameters
     auto frequency = apvts.getRawParameterValue("LPF");
     auto volume = apvts.getRawParameterValue("VOL");
-//    outputVolume = Decibels::decibelsToGain(volume->load())
+    auto irMix = apvts.getRawParameterValue("IRMIX");
+    auto linearPhase = apvts.getRawParameterValue("LPFMODE")->load() > 0.5f;
     
-    for (int channel = 0; channel < 2; ++channel)
+    //the first switch to linear phase has the filter built off the audio thread; the latency follows once it runs
+    if (linearPhase != linearPhaseMode)
     {
-        iirFilter[channel].setCoefficients(IIRCoefficients::makeLowPass(getSampleRate(), frequency->load()));
-        outputVolume[channel].setTargetValue( Decibels::decibelsToGain(volume->load()));
+        linearPhaseMode = linearPhase;
+        
+        if (linearPhaseFilter.isPrepared())
+            linearPhaseFilter.reset();
+        
+        triggerAsyncUpdate();
+    }
+    
+    //throughput mode changes our latency too; it starts again from an empty batch, so there's a gap either way
+    auto batching = apvts.getRawParameterValue("BATCHING")->load() > 0.5f;
+    
+    if (batching != batchingEnabled)
+    {
+        batchingEnabled = batching;
+        batcherNeedsReset = true;
+        batchLatency.store(batchingEnabled ? BlockBatcher::getLatencySamples() : 0);
+        triggerAsyncUpdate();
     }
     
+    //switched off, the governor hands back full quality straight away
+    auto governor = apvts.getRawParameterValue("GOVERNOR")->load() > 0.5f;
+    
+    if (governor != governorEnabled)
+    {
+        governorEnabled = governor;
+        cpuGovernor.reset();
+        applyGovernorLevel();
+    }
+    
+    sidechainDepth = apvts.getRawParameterValue("SCDEPTH")->load();
+    sidechainFollower.setTimes(apvts.getRawParameterValue("SCATTACK")->load(),
+                               apvts.getRawParameterValue("SCRELEASE")->load());
+    
+    compressor.setCurve(apvts.getRawParameterValue("COMPTHRESH")->load(), apvts.getRawParameterValue("COMPRATIO")->load());
+    compressor.setTimes(apvts.getRawParameterValue("COMPATTACK")->load(), apvts.getRawParameterValue("COMPRELEASE")->load());
+    
+//    outputVolume = Decibels::decibelsToGain(volume->load())
+    //the compressor's makeup is added to the volume, so it's smoothed with it and costs nothing extra
+    smoothing.setTargetValue(volumeSmoothing, Decibels::decibelsToGain(volume->load() + apvts.getRawParameterValue("COMPMAKEUP")->load()));
+    smoothing.setTargetValue(mixSmoothing, irMix->load() / 100.0f);
+    smoothing.setTargetValue(cutoffSmoothing, frequency->load());
+    smoothing.setTargetValue(reverbMixSmoothing, apvts.getRawParameterValue("REVMIX")->load() / 100.0f);
+    reverb.setParameters(apvts.getRawParameterValue("REVDECAY")->load(), apvts.getRawParameterValue("REVDAMP")->load());
+    reverbTailSeconds.store(apvts.getRawParameterValue("REVMIX")->load() > 0.0f ? apvts.getRawParameterValue("REVDECAY")->load() : 0.0);
+    
+    //multiband: "Off", then 3, 4 or 5 bands, split at the first bands - 1 crossovers
+    static const char* const crossoverIDs[] = { "XOVER1", "XOVER2", "XOVER3", "XOVER4" };
+    static const char* const bandGainIDs[] = { "BAND1GAIN", "BAND2GAIN", "BAND3GAIN", "BAND4GAIN", "BAND5GAIN" };
+    
+    auto bandsChoice = (int) apvts.getRawParameterValue("MBBANDS")->load();
+    float crossovers[MultibandCrossover::maxBands - 1];
+    
+    for (int split = 0; split < MultibandCrossover::maxBands - 1; ++split)
+        crossovers[split] = apvts.getRawParameterValue(crossoverIDs[split])->load();
+    
+    multiband.setBands(bandsChoice == 0 ? 0 : bandsChoice + MultibandCrossover::minBands - 1, crossovers);
+    
+    for (int band = 0; band < MultibandCrossover::maxBands; ++band)
+        smoothing.setTargetValue(bandGainSmoothing + band, Decibels::decibelsToGain(apvts.getRawParameterValue(bandGainIDs[band])->load()));
+    
+    clipShape = (Waveshaper::Shape) (int) apvts.getRawParameterValue("SHAPE")->load();
+    clipAntialiasing = (Waveshaper::Antialiasing) (int) apvts.getRawParameterValue("SHAPEAA")->load();
+    applyClipShape();
+    
+    //a cutoff at rest gets exact coefficients here; a moving one is driven from processSubBlock
+    if (! smoothing.isSmoothing(cutoffSmoothing) && ! cutoffIsModulated)
+        setExactCutoff();
 }
 
 void PluginTemplateAudioProcessor::reset()
 {
   //Reset DSP parameters
-    for (int channel = 0; channel < 2; ++channel)
-        
+    //the filter lives in the state arena, so there's nothing to reset before prepare
+    if (filter != nullptr)
     {
-        iirFilter[channel].reset();
-        outputVolume[channel].reset(getSampleRate(), 0.050);
+        for (auto& state : filter->z)
+            state[0] = state[1] = 0.0f;
     }
     
+    //every smoothed parameter jumps to where it's going
+    smoothing.reset();
+    
+    if (filter != nullptr)
+        setExactCutoff();
+    
+    {
+        const SpinLock::ScopedLockType sl (convolutionLock);
+        
+        if (convolution != nullptr)
+            convolution->reset();
+    }
+    
+    linearPhaseFilter.reset();
+    sidechainFollower.reset();
+    compressor.reset();
+    batcher.reset();
+    batcherNeedsReset = false;
+    multiband.reset();
+    reverb.reset();
+    
+    for (auto& oversampler : clipOversampler)
+        oversampler.reset();
+    
+    for (auto& shaper : clipShaper)
+        shaper.reset();
+    
     meterLocalMaxVal.store(0.0f);
     meterGlobalMaxVal.store(0.0f);
 }
 
+void PluginTemplateAudioProcessor::applyModulatedCutoff (float cutoff)
+{
+    //depth is in octaves, so a full scale sidechain moves the cutoff by sidechainDepth octaves
+    auto envelope = jmin(sidechainFollower.getEnvelope(), 1.0f);
+    cutoff = jlimit(20.0f, maxCutoff, cutoff * std::exp2(sidechainDepth * envelope));
+    
+    //whichever filter is actually running gets the new cutoff; until the FIR is ready that's the biquad
+    if (linearPhaseLive)
+    {
+        //each new cutoff is a kernel redesign, so the FIR only follows in semitone steps
+        linearPhaseFilter.setCutoff(std::exp2(std::round(12.0f * std::log2(cutoff)) / 12.0f));
+    }
+    else
+    {
+        cutoffTable->lookup(cutoff, filter->coefficients);
+    }
+    
+    cutoffIsModulated = true;
+}
+
+void PluginTemplateAudioProcessor::setExactCutoff()
+{
+    //the table is only for a cutoff on the move; at rest both filters get the real thing
+    auto cutoff = smoothing.getCurrentValue(cutoffSmoothing);
+    
+    auto lowPass = IIRCoefficients::makeLowPass(getSampleRate(), cutoff);
+    std::copy(lowPass.coefficients, lowPass.coefficients + 5, filter->coefficients);
+    linearPhaseFilter.setCutoff(cutoff);
+    
+    cutoffIsModulated = false;
+}
+
+void PluginTemplateAudioProcessor::setQualityProfile (QualityProfile profile)
+{
+    //only flips settings on things prepare already built, so this is fine on the audio thread
+    qualityProfile = profile;
+    auto offline = profile == QualityProfile::offline;
+    
+    for (auto& oversampler : clipOversampler)
+        oversampler.setNumStages(offline ? offlineClipOversamplingStages : 0);
+    
+    //the shapers' last few inputs were at the old rate
+    for (auto& shaper : clipShaper)
+        shaper.reset();
+    
+    //an offline render never touches the governor, so realtime picks up again at full quality
+    cpuGovernor.reset();
+    applyGovernorLevel();
+}
+
+void PluginTemplateAudioProcessor::applyGovernorLevel()
+{
+    auto level = cpuGovernor.getLevel();
+    governorLevel.store(level);
+    flightRecorder.record(FlightRecorder::EventType::qualityLevel, level, cpuGovernor.getAverageLoad());
+    
+    //each level halves how often the sidechain and a moving cutoff update the coefficients
+    sidechainFollower.setControlInterval(qualityProfile == QualityProfile::offline ? 1 : EnvelopeFollower::defaultControlInterval << level);
+    applyClipShape();
+}
+
+void PluginTemplateAudioProcessor::applyClipShape()
+{
+    //the governor takes the anti-aliasing down one order per level, and off at worst
+    auto antialiasing = jmax(0, (int) clipAntialiasing - cpuGovernor.getLevel());
+    
+    for (auto& shaper : clipShaper)
+        shaper.setShape(clipShape, (Waveshaper::Antialiasing) antialiasing);
+}
+
+void PluginTemplateAudioProcessor::updateFilterLatency()
+{
+    //the FIR takes over from the biquad at the first block after the message thread has built it
+    auto wasLive = linearPhaseLive;
+    linearPhaseLive = linearPhaseMode && linearPhaseFilter.isPrepared();
+    
+    //the biquad stood still while the FIR ran, so its state is from whenever linear phase was switched on;
+    //coming back it starts from silence instead, like the FIR does going the other way
+    if (wasLive && ! linearPhaseLive && filter != nullptr)
+    {
+        for (auto& state : filter->z)
+            state[0] = state[1] = 0.0f;
+    }
+    
+    auto latency = linearPhaseLive ? LinearPhaseLowPass::getLatencySamples() : 0;
+    
+    if (filterLatency.exchange(latency) != latency)
+        triggerAsyncUpdate();
+}
+
+void PluginTemplateAudioProcessor::handleAsyncUpdate()
+{
+    setLatencySamples(filterLatency.load() + batchLatency.load());
+    
+    //linear phase was picked for the first time; the audio thread leaves the filter alone until it's ready,
+    //and reports the new latency once it has switched over
+    if (apvts.getRawParameterValue("LPFMODE")->load() > 0.5f && ! linearPhaseFilter.isPrepared() && getSampleRate() > 0.0)
+        linearPhaseFilter.prepare(getSampleRate(), apvts.getRawParameterValue("LPF")->load());
+    
+    //an xrun writes the recording out, but a burst of them only gets one file every few seconds
+    if (flightRecordingRequested.exchange(false))
+    {
+        auto now = Time::getMillisecondCounterHiRes() * 0.001;
+        
+        if (lastAutomaticRecordingTime == 0.0 || now - lastAutomaticRecordingTime > 10.0)
+        {
+            lastAutomaticRecordingTime = now;
+            
+            auto file = File::getSpecialLocation(File::tempDirectory)
+                          .getNonexistentChildFile(String(JucePlugin_Name) + "-xrun-" + Time::getCurrentTime().formatted("%Y%m%d-%H%M%S"), ".json");
+            
+            saveFlightRecording(file);
+        }
+    }
+}
+
+void PluginTemplateAudioProcessor::recordParameterChanges()
+{
+    for (size_t i = 0; i < recordedParameters.size(); ++i)
+    {
+        auto value = recordedParameters[i]->load();
+        
+        if (value != lastRecordedValues[i])
+        {
+            lastRecordedValues[i] = value;
+            flightRecorder.record(FlightRecorder::EventType::parameterChange, (int) i, value);
+        }
+    }
+}
+
+bool PluginTemplateAudioProcessor::saveFlightRecording (const File& file) const
+{
+    std::vector<FlightRecorder::Event> events;
+    flightRecorder.snapshot(events);
+    
+    return file.replaceWithText(FlightRecorder::toTraceJson(events, recordedParameterNames));
+}
+
 //void PluginTemplateAudioProcessor::userChangedParameter()
 //{
 //    mustUpdateProcessing = true;
@@ -300,6 +959,50 @@ AudioProcessorValueTreeState::ParameterLayout PluginTemplateAudioProcessor::crea
     //create our parameters for VOL
     parameters.push_back(std::make_unique<AudioParameterFloat >("VOL", "Volume",NormalisableRange<float>(-40.0f, 40.0f),0.0f,"db",AudioProcessorParameter::genericParameter,valueToTextFunction,textToValueFunction ));
     
+    //Convolution dry/wet, only heard once an impulse response is loaded
+    parameters.push_back(std::make_unique<AudioParameterFloat >("IRMIX", "IR Mix", NormalisableRange<float>(0.0f, 100.0f), 100.0f, "%", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    //Filter phase; linear phase adds latency, reported to the host
+    parameters.push_back(std::make_unique<AudioParameterChoice>("LPFMODE", "Filter Phase", StringArray { "Minimum Phase", "Linear Phase" }, 0));
+    
+    //Sidechain envelope -> LPF cutoff; negative depth ducks the filter, positive opens it like an auto-wah
+    parameters.push_back(std::make_unique<AudioParameterFloat >("SCDEPTH", "Sidechain Depth", NormalisableRange<float>(-8.0f, 8.0f), 0.0f, "oct", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("SCATTACK", "Sidechain Attack", NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.4f), 5.0f, "ms", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("SCRELEASE", "Sidechain Release", NormalisableRange<float>(5.0f, 1000.0f, 1.0f, 0.4f), 150.0f, "ms", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    //Reverb: an 8 line feedback delay network after the filter; the mix is a send level, so 0% is off
+    parameters.push_back(std::make_unique<AudioParameterFloat >("REVMIX", "Reverb Mix", NormalisableRange<float>(0.0f, 100.0f), 0.0f, "%", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("REVDECAY", "Reverb Decay", NormalisableRange<float>(0.2f, 10.0f, 0.01f, 0.5f), 2.0f, "s", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("REVDAMP", "Reverb Damping", NormalisableRange<float>(1000.0f, 20000.0f, 1.0f, 0.4f), 8000.0f, "Hz", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    //Output clipper: the curve, and antiderivative anti-aliasing, which costs far less than oversampling
+    parameters.push_back(std::make_unique<AudioParameterChoice>("SHAPE", "Clip Shape", StringArray { "Hard", "Tanh", "Cubic", "Tube" }, 0));
+    parameters.push_back(std::make_unique<AudioParameterChoice>("SHAPEAA", "Clip Anti-Aliasing", StringArray { "Off", "ADAA 1st Order", "ADAA 2nd Order" }, 0));
+    
+    //Multiband: Linkwitz-Riley crossovers, with a gain into a clipper in every band; flat when the gains are at 0 dB
+    parameters.push_back(std::make_unique<AudioParameterChoice>("MBBANDS", "Multiband", StringArray { "Off", "3 Bands", "4 Bands", "5 Bands" }, 0));
+    
+    const float crossoverDefaults[MultibandCrossover::maxBands - 1] = { 120.0f, 1000.0f, 4000.0f, 10000.0f };
+    
+    for (int split = 0; split < MultibandCrossover::maxBands - 1; ++split)
+        parameters.push_back(std::make_unique<AudioParameterFloat >("XOVER" + String(split + 1), "Crossover " + String(split + 1), NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.25f), crossoverDefaults[split], "Hz", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    for (int band = 0; band < MultibandCrossover::maxBands; ++band)
+        parameters.push_back(std::make_unique<AudioParameterFloat >("BAND" + String(band + 1) + "GAIN", "Band " + String(band + 1) + " Gain", NormalisableRange<float>(-24.0f, 24.0f), 0.0f, "db", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    //CPU governor: on an overloaded machine, give up a little quality rather than drop out
+    parameters.push_back(std::make_unique<AudioParameterChoice>("GOVERNOR", "CPU Governor", StringArray { "Off", "On" }, 0));
+    
+    //Compressor: feed-forward and stereo linked, between the filter and the output gain; off at 1:1
+    parameters.push_back(std::make_unique<AudioParameterFloat >("COMPTHRESH", "Comp Threshold", NormalisableRange<float>(-60.0f, 0.0f), -18.0f, "db", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("COMPRATIO", "Comp Ratio", NormalisableRange<float>(1.0f, 20.0f, 0.1f, 0.4f), 1.0f, ":1", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("COMPATTACK", "Comp Attack", NormalisableRange<float>(0.1f, 100.0f, 0.1f, 0.4f), 10.0f, "ms", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("COMPRELEASE", "Comp Release", NormalisableRange<float>(5.0f, 1000.0f, 1.0f, 0.4f), 100.0f, "ms", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    parameters.push_back(std::make_unique<AudioParameterFloat >("COMPMAKEUP", "Comp Makeup", NormalisableRange<float>(0.0f, 24.0f), 0.0f, "db", AudioProcessorParameter::genericParameter, valueToTextFunction, textToValueFunction));
+    
+    //Throughput mode: batches tiny host blocks into bigger ones, for a fixed extra latency reported to the host
+    parameters.push_back(std::make_unique<AudioParameterChoice>("BATCHING", "Throughput Mode", StringArray { "Off", "On" }, 0));
+    
 //    auto gainParam = ;
 //    //add them to the vector
     
@@ -308,3 +1011,141 @@ AudioProcessorValueTreeState::ParameterLayout PluginTemplateAudioProcessor::crea
  
     return { parameters.begin(), parameters.end() };
 }
+
+//==============================================================================
+bool PluginTemplateAudioProcessor::loadImpulseResponse (const File& file)
+{
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    
+    AudioBuffer<float> newResponse;
+    double newSampleRate = 0.0;
+    
+    auto readResponse = [&] (AudioFormatReader& reader)
+    {
+        auto maxLength = (int64) (maxImpulseResponseSeconds * reader.sampleRate);
+        auto length = (int) jmin(reader.lengthInSamples, maxLength);
+        auto numChannels = jlimit(1, 2, (int) reader.numChannels);
+        
+        newResponse.setSize(numChannels, length);
+        newSampleRate = reader.sampleRate;
+        
+        return length > 0 && reader.read(&newResponse, 0, length, 0, true, numChannels > 1);
+    };
+    
+    auto loaded = false;
+    
+    //WAV and AIFF are mapped straight into memory instead of being streamed through a buffer
+    if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+    {
+        std::unique_ptr<MemoryMappedAudioFormatReader> mappedReader (format->createMemoryMappedReader(file));
+        
+        if (mappedReader != nullptr && mappedReader->mapEntireFile())
+            loaded = readResponse(*mappedReader);
+    }
+    
+    if (! loaded)
+    {
+        std::unique_ptr<AudioFormatReader> reader (formatManager.createReaderFor(file));
+        
+        if (reader != nullptr)
+            loaded = readResponse(*reader);
+    }
+    
+    if (! loaded)
+        return false;
+    
+    {
+        const ScopedLock sl (impulseResponseLock);
+        impulseResponse = std::move(newResponse);
+        impulseResponseSampleRate = newSampleRate;
+    }
+    
+    apvts.state.setProperty("IRFile", file.getFullPathName(), nullptr);
+    rebuildConvolution();
+    return true;
+}
+
+void PluginTemplateAudioProcessor::clearImpulseResponse()
+{
+    {
+        const ScopedLock sl (impulseResponseLock);
+        impulseResponse.setSize(0, 0);
+    }
+    
+    apvts.state.setProperty("IRFile", String(), nullptr);
+    rebuildConvolution();
+}
+
+String PluginTemplateAudioProcessor::getImpulseResponseName() const
+{
+    return File(apvts.state.getProperty("IRFile").toString()).getFileNameWithoutExtension();
+}
+
+void PluginTemplateAudioProcessor::rebuildConvolution()
+{
+    //builds the engine off the audio thread, then swaps it in under the lock
+    std::unique_ptr<ConvolutionEngine> newEngine;
+    auto sampleRate = getSampleRate();
+    
+    {
+        const ScopedLock sl (impulseResponseLock);
+        
+        if (impulseResponse.getNumSamples() > 0 && sampleRate > 0.0)
+        {
+            auto ratio = impulseResponseSampleRate / sampleRate;
+            auto length = jmax(1, (int) (impulseResponse.getNumSamples() / ratio));
+            AudioBuffer<float> resampled (impulseResponse.getNumChannels(), length);
+            auto energy = 0.0;
+            
+            //linear interpolation is plenty for a response that's already band-limited
+            for (int channel = 0; channel < resampled.getNumChannels(); ++channel)
+            {
+                auto* source = impulseResponse.getReadPointer(channel);
+                auto* dest = resampled.getWritePointer(channel);
+                auto lastIndex = impulseResponse.getNumSamples() - 1;
+                
+                for (int i = 0; i < length; ++i)
+                {
+                    auto position = i * ratio;
+                    auto index = jmin((int) position, lastIndex);
+                    auto frac = (float) (position - index);
+                    dest[i] = source[index] + frac * (source[jmin(index + 1, lastIndex)] - source[index]);
+                    energy += dest[i] * dest[i];
+                }
+            }
+            
+            //unit energy per channel keeps loud and quiet responses at a similar level
+            if (energy > 0.0)
+                resampled.applyGain((float) std::sqrt(resampled.getNumChannels() / energy));
+            
+            newEngine = std::make_unique<ConvolutionEngine>(resampled);
+            convolutionTailSeconds.store(length / sampleRate);
+        }
+        else
+        {
+            convolutionTailSeconds.store(0.0);
+        }
+    }
+    
+    convolutionSampleRate = sampleRate;
+    
+    {
+        const SpinLock::ScopedLockType sl (convolutionLock);
+        std::swap(convolution, newEngine);
+    }
+    
+    //newEngine now holds the old one, which is released here rather than on the audio thread
+}
+
+//==============================================================================
+void PluginTemplateAudioProcessor::setKernelVariant (DSPKernels::Variant variant)
+{
+    kernelVariant.store(variant);
+    kernels.store(&DSPKernels::getKernels(variant));
+}
+
+String PluginTemplateAudioProcessor::getKernelVariantName() const
+{
+    return kernels.load()->name;
+}
@@ -9,12 +9,31 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DSPStateArena.h"
+#include "SubBlockEngine.h"
+#include "ConvolutionEngine.h"
+#include "LinearPhaseFilter.h"
+#include "DSPKernels.h"
+#include "CoefficientTable.h"
+#include "SharedFilterDesigns.h"
+#include "EnvelopeFollower.h"
+#include "Oversampler.h"
+#include "FlightRecorder.h"
+#include "SmoothingEngine.h"
+#include "MultibandCrossover.h"
+#include "Waveshaper.h"
+#include "FDNReverb.h"
+#include "LinkedCompressor.h"
+#include "ProcessorChain.h"
+#include "CpuGovernor.h"
+#include "BlockBatcher.h"
 
 //==============================================================================
 /**
 */
 class PluginTemplateAudioProcessor  :   public juce::AudioProcessor,
-                                        public ValueTree::Listener
+                                        public ValueTree::Listener,
+                                        private AsyncUpdater
 {
 public:
     //==============================================================================
@@ -62,15 +81,194 @@ public:
     
     AudioProcessorValueTreeState apvts;
     AudioProcessorValueTreeState::ParameterLayout createParameters();
-    std::atomic<float> meterLocalMaxVal, meterGlobalMaxVal;
+    std::atomic<float> meterLocalMaxVal { 0.0f }, meterGlobalMaxVal { 0.0f };
+    std::atomic<int> governorLevel { 0 };     //how far the CPU governor has stepped quality down, for the editor
     
+    //Impulse response for the convolution stage; call from the message thread
+    bool loadImpulseResponse (const File& file);
+    void clearImpulseResponse();
+    String getImpulseResponseName() const;
+    
+    //Which SIMD flavour the hot loops run in; automatic picks the best the CPU has.
+    //Forcing one is mostly useful for benchmarking, as is the PLUGINTEMPLATE_KERNELS env var.
+    void setKernelVariant (DSPKernels::Variant variant);
+    String getKernelVariantName() const;
+    
+    //Writes the last few seconds of audio thread history as Chrome trace / Perfetto JSON.
+    //This also happens by itself, into the temp folder, whenever a block misses its deadline.
+    bool saveFlightRecording (const File& file) const;
     
 private:
-    bool mustUpdateProcessing { false };
+    //the self-test drives two instances side by side, and tells them about parameter changes straight away
+    friend class KernelSelfTest;
+    
+    //set on whichever thread changed a parameter, cleared on the audio thread
+    std::atomic<bool> mustUpdateProcessing { false };
     bool isActive { false };
 //    float outputVolume = { 0.0 };
-    LinearSmoothedValue<float> outputVolume [2] { 0.0 };
-    IIRFilter iirFilter[2];
+    
+    //every smoothed parameter, rendered once per sub-block and shared by both channels; one gain per band at the end
+    enum SmoothedParameters { volumeSmoothing, mixSmoothing, cutoffSmoothing, reverbMixSmoothing, bandGainSmoothing,
+                              numSmoothedParameters = bandGainSmoothing + MultibandCrossover::maxBands };
+    SmoothingEngine smoothing;
+    
+    //the biquad's coefficients and both channels' state, together on one cache line of the state arena
+    struct FilterState
+    {
+        float coefficients[5];
+        float z[SubBlockEngine::maxChannels][2];
+    };
+    
+    FilterState* filter { nullptr };
+    
+    std::atomic<DSPKernels::Variant> kernelVariant { DSPKernels::Variant::automatic };
+    std::atomic<const DSPKernels::KernelTable*> kernels { &DSPKernels::getKernels(DSPKernels::Variant::scalar) };
+    
+    //Linear phase mode of the LPF; the host is told about its latency from the message thread
+    LinearPhaseLowPass linearPhaseFilter;      //prepared the first time linear phase is picked
+    bool linearPhaseMode { false };
+    bool linearPhaseLive { false };            //picked and built; until then the biquad stands in, with no latency
+    std::atomic<int> filterLatency { 0 };      //what's actually running, not what was asked for
+    
+    void updateFilterLatency();
+    
+    //Sidechain: its envelope moves the LPF cutoff by up to sidechainDepth octaves
+    EnvelopeFollower sidechainFollower;
+    SharedResourcePointer<SharedFilterDesigns> sharedDesigns;
+    std::shared_ptr<const LowPassCoefficientTable> cutoffTable;     //shared by every instance at this rate
+    float sidechainDepth { 0.0f };
+    bool cutoffIsModulated { false };
+    
+    //the top of the LPF range; at rest there, the filter is left out altogether
+    static constexpr float maxCutoff = 20000.0f;
+    
+    void applyModulatedCutoff (float cutoff);
+    void setExactCutoff();
+    
+    //Quality profile: offline bounces get an 8x oversampled clipper and per-sample sidechain updates.
+    //Everything both profiles need is allocated in prepare, so switching is free on the audio thread.
+    enum class QualityProfile { realtime, offline };
+    QualityProfile qualityProfile { QualityProfile::realtime };
+    Oversampler clipOversampler [2];
+    static constexpr int offlineClipOversamplingStages = 3;
+    
+    void setQualityProfile (QualityProfile profile);
+    
+    //CPU governor: optional, and only for realtime blocks. Each level it steps down spaces the
+    //sidechain and moving cutoff's coefficient updates further apart and drops an order of clipper ADAA.
+    CpuGovernor cpuGovernor;
+    bool governorEnabled { false };
+    
+    void applyGovernorLevel();
+    
+    //Throughput mode: small host blocks are collected into whole sub-blocks and processed a batch later,
+    //for hosts that call with tiny buffers when nobody is listening live. The batch is added to our latency.
+    BlockBatcher batcher;
+    bool batchingEnabled { false };
+    bool batcherNeedsReset { false };
+    std::atomic<int> batchLatency { 0 };
+    
+    //Multiband: split before the gain and clip stages, each band with its own gain and clipper
+    MultibandCrossover multiband;
+    
+    //Compressor straight after the filter, one detector for every channel; its makeup gain rides on the volume ramp
+    LinkedCompressor compressor;
+    
+    //Reverb after the filter; skipped while its mix is at zero, and cleared before it starts again
+    FDNReverb reverb;
+    bool reverbRunning { false };
+    std::atomic<double> reverbTailSeconds { 0.0 };
+    
+    //Output clipper curve; a plain hard clip without anti-aliasing is left to the clip kernel
+    Waveshaper clipShaper [2];
+    Waveshaper::Shape clipShape { Waveshaper::Shape::hard };
+    Waveshaper::Antialiasing clipAntialiasing { Waveshaper::Antialiasing::off };     //as picked, before the governor
+    
+    void applyClipShape();
+    
+    //Flight recorder: always on, written by the audio thread only
+    FlightRecorder flightRecorder;
+    StringArray recordedParameterNames;
+    std::vector<std::atomic<float>*> recordedParameters;
+    std::vector<float> lastRecordedValues;
+    int64 deadlineTicksPerSample { 0 };
+    int clippedChannels { 0 };
+    float blockPeak { 0.0f };
+    std::atomic<bool> flightRecordingRequested { false };
+    double lastAutomaticRecordingTime { 0.0 };
+    
+    void recordParameterChanges();
+    
+    void handleAsyncUpdate() override;
+    
+    //scratch buffers per channel handed out by the sub-block engine
+    enum ScratchBuffers { dryScratch, gainScratch, numScratchBuffers };
+    SubBlockEngine subBlockEngine;
+    
+    //the settings prepare last built everything for
+    double preparedSampleRate { 0.0 };
+    int preparedBlockSize { 0 };
+    
+    //all the hot per-block state in one allocation: scratch, smoothing ramps and the filter
+    enum StateRegions { scratchRegion, rampRegion, filterRegion };
+    DSPStateArena stateArena;
+    
+    //Convolution: the raw response as loaded, and the engine built from it for the current rate
+    static constexpr double maxImpulseResponseSeconds = 10.0;
+    AudioBuffer<float> impulseResponse;
+    double impulseResponseSampleRate { 0.0 };
+    CriticalSection impulseResponseLock;
+    
+    std::unique_ptr<ConvolutionEngine> convolution;
+    SpinLock convolutionLock;
+    double convolutionSampleRate { 0.0 };
+    std::atomic<double> convolutionTailSeconds { 0.0 };
+    
+    void rebuildConvolution();
+    
+    //everything processBlock does, on either a host block or a batch
+    void processInternal (AudioBuffer<float>& buffer);
+    
+    void processSubBlock (float* const* channels, int numChannels, int numSamples,
+                          const float* const* sidechain, int numSidechainChannels,
+                          ConvolutionEngine* convolutionEngine,
+                          float* channelMaxVal, float& currentMaxVal);
+    
+    //The sub-block chain: everything a stage needs, then one small handle per stage
+    struct SubBlockContext
+    {
+        float* const* channels;
+        int numChannels, numSamples;
+        const float* const* sidechain;
+        int numSidechainChannels;
+        ConvolutionEngine* convolutionEngine;
+        float* channelMaxVal;
+        float& currentMaxVal;
+        const DSPKernels::KernelTable& kernels;
+        float channelPeaks[SubBlockEngine::maxChannels];    //filled in by the meter, for the clipper
+    };
+    
+    void filterSubBlock (SubBlockContext& context) noexcept;
+    void compressorSubBlock (SubBlockContext& context) noexcept;
+    void reverbSubBlock (SubBlockContext& context) noexcept;
+    void convolutionSubBlock (SubBlockContext& context) noexcept;
+    void multibandSubBlock (SubBlockContext& context) noexcept;
+    void volumeSubBlock (SubBlockContext& context) noexcept;
+    void meterSubBlock (SubBlockContext& context) noexcept;
+    void clipSubBlock (SubBlockContext& context) noexcept;
+    
+    struct FilterStage       { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.filterSubBlock(c); } };
+    struct CompressorStage   { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.compressorSubBlock(c); } };
+    struct ReverbStage       { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.reverbSubBlock(c); } };
+    struct ConvolutionStage  { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.convolutionSubBlock(c); } };
+    struct MultibandStage    { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.multibandSubBlock(c); } };
+    struct VolumeStage       { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.volumeSubBlock(c); } };
+    struct MeterStage        { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.meterSubBlock(c); } };
+    struct ClipStage         { PluginTemplateAudioProcessor& p; void process (SubBlockContext& c) noexcept { p.clipSubBlock(c); } };
+    
+    ProcessorChain<SubBlockContext, FilterStage, CompressorStage, ReverbStage, ConvolutionStage, MultibandStage, VolumeStage, MeterStage, ClipStage> chain {
+        FilterStage { *this }, CompressorStage { *this }, ReverbStage { *this }, ConvolutionStage { *this }, MultibandStage { *this },
+        VolumeStage { *this }, MeterStage { *this }, ClipStage { *this } };
     
     void valueTreePropertyChanged (ValueTree &treeWhosePropertyHasChanged, const Identifier &property) override
     {
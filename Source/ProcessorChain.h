@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    ProcessorChain.h
+
+    A processing chain put together at compile time from stage types, with
+    no virtual calls, in the spirit of juce::dsp::ProcessorChain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Stages come in two kinds, told apart at compile time:
+
+    - block stages have
+          void process (Context&) noexcept
+      and do whatever they like with the whole block.
+
+    - per-sample stages have
+          bool prepareBlock (Context&) noexcept
+          float processSample (int channel, int sample, float x) noexcept
+      and must not depend on anything but their own input sample, so that
+      a run of them can share one loop. prepareBlock() returns false when
+      the stage would leave this block as it is.
+
+    Each run of adjacent per-sample stages becomes a single loop over every
+    channel's samples, with all of their processSample() calls inlined into
+    its body. The data goes through memory once for the whole run instead of
+    once per stage, and simple element-wise bodies still vectorise. When no
+    stage in a run has anything to do, the loop doesn't run at all.
+
+    Context is whatever the stages need to share. It must have channels,
+    numChannels and numSamples members for the fused loops.
+
+    A different product variant is just a different list of stage types.
+*/
+template <typename Context, typename... Stages>
+class ProcessorChain
+{
+public:
+    /** Stages are usually small handles onto their owner, so they're passed in constructed. */
+    explicit ProcessorChain (Stages... newStages)
+        : stages (std::move (newStages)...)
+    {
+    }
+
+    template <size_t Index>
+    auto& get() noexcept                  { return std::get<Index> (stages); }
+
+    void process (Context& context) noexcept
+    {
+        processFrom<0> (context);
+    }
+
+private:
+    //==============================================================================
+    template <typename Stage, typename = void>
+    struct IsPerSample : std::false_type {};
+
+    template <typename Stage>
+    struct IsPerSample<Stage, decltype ((void) std::declval<Stage&>().processSample (0, 0, 0.0f))> : std::true_type {};
+
+    template <size_t Index>
+    using StageAt = std::tuple_element_t<Index, std::tuple<Stages...>>;
+
+    // what processFrom() does at Index: stop, run one block stage, or fuse a per-sample run
+    struct EndOfChain {};
+    struct BlockStage {};
+    struct PerSampleRun {};
+
+    template <size_t Index, bool = (Index < sizeof... (Stages))>
+    struct KindOf { using type = EndOfChain; };
+
+    template <size_t Index>
+    struct KindOf<Index, true> { using type = std::conditional_t<IsPerSample<StageAt<Index>>::value, PerSampleRun, BlockStage>; };
+
+    // one past the last stage of the per-sample run that starts at Index
+    template <size_t Index, bool = (Index < sizeof... (Stages))>
+    struct EndOfRun : std::integral_constant<size_t, Index> {};
+
+    template <size_t Index>
+    struct EndOfRun<Index, true> : std::conditional_t<IsPerSample<StageAt<Index>>::value,
+                                                      EndOfRun<Index + 1>,
+                                                      std::integral_constant<size_t, Index>> {};
+
+    template <size_t Index>
+    void processFrom (Context& context) noexcept
+    {
+        processFrom<Index> (context, typename KindOf<Index>::type());
+    }
+
+    template <size_t Index>
+    void processFrom (Context&, EndOfChain) noexcept
+    {
+    }
+
+    template <size_t Index>
+    void processFrom (Context& context, BlockStage) noexcept
+    {
+        std::get<Index> (stages).process (context);
+        processFrom<Index + 1> (context);
+    }
+
+    template <size_t Index>
+    void processFrom (Context& context, PerSampleRun) noexcept
+    {
+        processRun<Index> (context, std::make_index_sequence<EndOfRun<Index>::value - Index>());
+        processFrom<EndOfRun<Index>::value> (context);
+    }
+
+    // the initializer lists only expand each pack in order; the compiler never builds them
+    template <size_t First, size_t... Offsets>
+    void processRun (Context& context, std::index_sequence<Offsets...>) noexcept
+    {
+        // every stage gets its prepareBlock() call, whatever the others said
+        auto anyActive = false;
+        (void) std::initializer_list<int> { ((anyActive = std::get<First + Offsets> (stages).prepareBlock (context) || anyActive), 0)... };
+
+        if (! anyActive)
+            return;
+
+        for (int channel = 0; channel < context.numChannels; ++channel)
+        {
+            auto* data = context.channels[channel];
+
+            for (int i = 0; i < context.numSamples; ++i)
+            {
+                auto x = data[i];
+                (void) std::initializer_list<int> { ((x = std::get<First + Offsets> (stages).processSample (channel, i, x)), 0)... };
+                data[i] = x;
+            }
+        }
+    }
+
+    std::tuple<Stages...> stages;
+};
@@ -0,0 +1,291 @@
+/*
+  ==============================================================================
+
+    SharedAudioRing.h
+
+    The shared-memory side of the DSP server protocol: a ring of audio
+    blocks that the server creates and a client maps as well.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <fcntl.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#if JUCE_LINUX
+ #include <sys/mman.h>
+#endif
+
+//==============================================================================
+/**
+    The server creates the ring in the format a client asks for, writes the
+    header and tells the client where to map it. Audio never crosses the
+    connection. The client writes a block straight into a slot, the server's
+    processor runs in place on that slot, and the client reads the result
+    from where it wrote the input.
+
+    Who may touch a slot is settled by the messages on the connection (see
+    DSPServer), so the shared memory itself needs no atomics: the socket
+    write and read in between order the memory accesses.
+
+    A client can scribble over the ring, but it mustn't be able to take the
+    server down with it. Both sides keep their own copy of the format, and
+    nothing reads the header after open(). Shrinking the ring under the
+    server's mapping would make its next access fault, so on Linux the ring
+    is a memfd sealed at its size, which nobody can truncate, and the client
+    maps it through the server's /proc entry. Elsewhere it's a file the
+    server made, readable by its owner alone, which a client of the same
+    user could still truncate.
+
+    Layout: a header on a cache line of its own, then numSlots slots of
+    numChannels channels, each channel maxBlockSize floats rounded up to a
+    whole number of cache lines.
+*/
+class SharedAudioRing
+{
+public:
+    static constexpr uint32 magic = 0x50544452;            // "PTDR"
+    static constexpr int32 version = 1;
+    static constexpr int maxChannels = 2;
+    static constexpr int maxBlockSizeLimit = 65536;
+    static constexpr int maxSlots = 256;
+
+    /** The messages on the connection. Each one starts with its type as an int. */
+    enum MessageType
+    {
+        hello = 1,      // client: channels, max block size, slots, sample rate, nonRealtime flag, state size and state
+        ready,          // server: the processor is prepared, followed by the path to map the ring from
+        error,          // server: a reason, and then it hangs up
+        process,        // client: slot, number of samples
+        done            // server: slot
+    };
+
+    /** Used as the connection's message header, so strays are thrown out. */
+    static constexpr uint32 connectionMagic = 0x50544453;  // "PTDS"
+
+    SharedAudioRing() = default;
+
+    //==============================================================================
+    static size_t getChannelStride (int maxBlockSize) noexcept
+    {
+        return ((size_t) maxBlockSize * sizeof (float) + cacheLineBytes - 1) / cacheLineBytes * cacheLineBytes;
+    }
+
+    static size_t getSize (int numChannels, int maxBlockSize, int numSlots) noexcept
+    {
+        return cacheLineBytes + (size_t) numSlots * (size_t) numChannels * getChannelStride (maxBlockSize);
+    }
+
+    //==============================================================================
+    /** Server side: makes a new ring, maps it and writes the header. */
+    bool create (int newNumChannels, int newMaxBlockSize, int newNumSlots, double newSampleRate)
+    {
+        close();
+
+        if (! isPositiveAndNotGreaterThan (newNumChannels, maxChannels) || newNumChannels == 0
+             || ! isPositiveAndNotGreaterThan (newMaxBlockSize, maxBlockSizeLimit) || newMaxBlockSize == 0
+             || ! isPositiveAndNotGreaterThan (newNumSlots, maxSlots) || newNumSlots == 0
+             || ! (newSampleRate > 0.0))
+            return false;
+
+        auto size = getSize (newNumChannels, newMaxBlockSize, newNumSlots);
+
+        if (! createBacking (size))
+            return false;
+
+        auto& header = getHeader();
+        header.version = version;
+        header.numChannels = newNumChannels;
+        header.maxBlockSize = newMaxBlockSize;
+        header.numSlots = newNumSlots;
+        header.sampleRate = newSampleRate;
+        header.magic = magic;
+
+        keepFormat (header);
+        return true;
+    }
+
+    /** Client side: maps the ring the server named, and checks its header. */
+    bool open (const File& fileToOpen)
+    {
+        close();
+
+        if (fileToOpen.getSize() < (int64) sizeof (Header))
+            return false;
+
+        if (! map (fileToOpen, (size_t) fileToOpen.getSize()))
+            return false;
+
+        auto header = getHeader();
+
+        if (header.magic != magic || header.version != version
+             || ! isPositiveAndNotGreaterThan (header.numChannels, maxChannels) || header.numChannels == 0
+             || ! isPositiveAndNotGreaterThan (header.maxBlockSize, maxBlockSizeLimit) || header.maxBlockSize == 0
+             || ! isPositiveAndNotGreaterThan (header.numSlots, maxSlots) || header.numSlots == 0
+             || ! (header.sampleRate > 0.0)
+             || mappedFile->getSize() < getSize (header.numChannels, header.maxBlockSize, header.numSlots))
+        {
+            close();
+            return false;
+        }
+
+        keepFormat (header);
+        return true;
+    }
+
+    /** Server side: where a client can map the ring from. */
+    File getFileForClient() const
+    {
+       #if JUCE_LINUX
+        if (descriptor >= 0)
+            return File ("/proc/" + String ((int) ::getpid()) + "/fd/" + String (descriptor));
+       #endif
+
+        return createdFile;
+    }
+
+    void close()
+    {
+        mappedFile.reset();
+
+       #if JUCE_LINUX
+        if (descriptor >= 0)
+            ::close (descriptor);
+
+        descriptor = -1;
+       #endif
+
+        // only the side that made the file removes it; the mapping above already let go of it
+        createdFile.deleteFile();
+        createdFile = File();
+
+        numChannels = maxBlockSize = numSlots = 0;
+        sampleRate = 0.0;
+        channelStride = 0;
+    }
+
+    bool isOpen() const noexcept                    { return mappedFile != nullptr; }
+
+    int getNumChannels() const noexcept             { return numChannels; }
+    int getMaxBlockSize() const noexcept            { return maxBlockSize; }
+    int getNumSlots() const noexcept                { return numSlots; }
+    double getSampleRate() const noexcept           { return sampleRate; }
+
+    float* getChannel (int slot, int channel) const noexcept
+    {
+        jassert (isPositiveAndBelow (slot, numSlots) && isPositiveAndBelow (channel, numChannels));
+
+        auto offset = cacheLineBytes + ((size_t) slot * (size_t) numChannels + (size_t) channel) * channelStride;
+
+        return reinterpret_cast<float*> (static_cast<char*> (mappedFile->getData()) + offset);
+    }
+
+private:
+    static constexpr size_t cacheLineBytes = 64;
+    static constexpr const char* filePrefix = "DSPServer-ring";
+    static constexpr const char* fileSuffix = ".tmp";
+
+    struct Header
+    {
+        uint32 magic;
+        int32 version;
+        int32 numChannels, maxBlockSize, numSlots;
+        int32 reserved;
+        double sampleRate;
+    };
+
+    static_assert (sizeof (Header) <= cacheLineBytes, "the header has a cache line to itself");
+
+    std::unique_ptr<MemoryMappedFile> mappedFile;
+    File createdFile;
+
+   #if JUCE_LINUX
+    int descriptor = -1;
+   #endif
+
+    // the format as it was when the ring was made or opened; the header is never read again
+    int numChannels = 0, maxBlockSize = 0, numSlots = 0;
+    double sampleRate = 0.0;
+    size_t channelStride = 0;
+
+    Header& getHeader() const noexcept          { return *static_cast<Header*> (mappedFile->getData()); }
+
+    void keepFormat (const Header& header) noexcept
+    {
+        numChannels = header.numChannels;
+        maxBlockSize = header.maxBlockSize;
+        numSlots = header.numSlots;
+        sampleRate = header.sampleRate;
+        channelStride = getChannelStride (maxBlockSize);
+    }
+
+    /** Zeroed shared memory of the given size, mapped, that no client can shrink where we can say so. */
+    bool createBacking (size_t size)
+    {
+       #if JUCE_LINUX
+        descriptor = ::memfd_create (filePrefix, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+        if (descriptor < 0)
+            return false;
+
+        if (::ftruncate (descriptor, (off_t) size) != 0
+             || ::fcntl (descriptor, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0
+             || ! map (File ("/proc/self/fd/" + String (descriptor)), size))
+        {
+            close();
+            return false;
+        }
+
+        return true;
+       #else
+        auto fileToCreate = File::getSpecialLocation (File::tempDirectory).getNonexistentChildFile (filePrefix, fileSuffix);
+
+        #if JUCE_MAC
+         auto fd = ::open (fileToCreate.getFullPathName().toRawUTF8(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+         if (fd < 0)
+             return false;
+
+         auto created = ::ftruncate (fd, (off_t) size) == 0;
+         ::close (fd);
+        #else
+         MemoryBlock zeros (size, true);
+         auto created = fileToCreate.replaceWithData (zeros.getData(), size);
+        #endif
+
+        // a file that was there first isn't ours to delete, so it only becomes ours once made
+        if (created)
+            createdFile = fileToCreate;
+
+        if (! created || ! map (fileToCreate, size))
+        {
+            close();
+            return false;
+        }
+
+        return true;
+       #endif
+    }
+
+    bool map (const File& fileToMap, size_t size)
+    {
+        mappedFile = std::make_unique<MemoryMappedFile> (fileToMap, Range<int64> (0, (int64) size), MemoryMappedFile::readWrite);
+
+        if (mappedFile->getData() == nullptr || mappedFile->getSize() < size)
+        {
+            mappedFile.reset();
+            return false;
+        }
+
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedAudioRing)
+};
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    SharedFilterDesigns.h
+
+    Process-wide cache of filter designs, so instances running the same
+    settings share one copy instead of each designing their own.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+//==============================================================================
+/**
+    Designs are keyed by what they are, the sample rate and a frequency, and
+    handed out as shared pointers to const data. Whoever holds one can read it
+    from any thread without locking, since nothing ever changes it again.
+
+    The cache only keeps weak references. A design lives exactly as long as
+    some instance is using it, and the entries of designs nobody uses any
+    more are swept out whenever a new one is added, so sessions that sweep
+    through many cutoffs don't leave a trail of dead keys behind either.
+
+    getOrDesign() locks, and may run the design function on the calling
+    thread, so it's for prepare() and designer threads only. The audio thread
+    just reads designs it was already handed.
+
+    Use it through a SharedResourcePointer, which creates the one instance
+    with the first user and deletes it with the last.
+*/
+class SharedFilterDesigns
+{
+public:
+    enum class Type
+    {
+        lowPassTable,           // LowPassCoefficientTable, frequency unused
+        linearPhaseLowPass      // ConvolutionPartitions of LinearPhaseLowPass's kernel
+    };
+
+    SharedFilterDesigns() = default;
+
+    //==============================================================================
+    /** Returns the design for this key, calling designFunction() to make it if no
+        one has it yet. designFunction returns a std::shared_ptr<Design>, and is
+        called without the lock held, so slow designs don't hold up other
+        threads. If two threads race to design the same key, the first one to
+        finish wins and both get its design.
+    */
+    template <typename Design, typename DesignFunction>
+    std::shared_ptr<const Design> getOrDesign (Type type, double sampleRate, float frequency, DesignFunction&& designFunction)
+    {
+        Key key { type, sampleRate, frequency };
+
+        {
+            const ScopedLock sl (lock);
+
+            if (auto existing = find (key))
+                return std::static_pointer_cast<const Design> (existing);
+        }
+
+        std::shared_ptr<const Design> design = designFunction();
+
+        const ScopedLock sl (lock);
+
+        if (auto existing = find (key))
+            return std::static_pointer_cast<const Design> (existing);
+
+        removeExpired();
+        designs[key] = design;
+        return design;
+    }
+
+private:
+    //==============================================================================
+    struct Key
+    {
+        Type type;
+        double sampleRate;
+        float frequency;
+
+        bool operator< (const Key& other) const noexcept
+        {
+            return std::tie (type, sampleRate, frequency) < std::tie (other.type, other.sampleRate, other.frequency);
+        }
+    };
+
+    std::map<Key, std::weak_ptr<const void>> designs;
+    CriticalSection lock;
+
+    // called with the lock held; clears out whatever it finds has died on the way
+    std::shared_ptr<const void> find (const Key& key)
+    {
+        auto entry = designs.find (key);
+
+        if (entry == designs.end())
+            return {};
+
+        if (auto design = entry->second.lock())
+            return design;
+
+        designs.erase (entry);
+        return {};
+    }
+
+    // called with the lock held, whenever a design is added; that's rare and far cheaper than the
+    // design itself, and it keeps the map no bigger than the set of designs actually in use
+    void removeExpired()
+    {
+        for (auto entry = designs.begin(); entry != designs.end();)
+        {
+            if (entry->second.expired())
+                entry = designs.erase (entry);
+            else
+                ++entry;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedFilterDesigns)
+};
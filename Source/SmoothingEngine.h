@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    SmoothingEngine.h
+
+    Renders every smoothed parameter into a ramp buffer once per block, for
+    all channels to share.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPStateArena.h"
+
+//==============================================================================
+/**
+    One place that smooths all of the processor's parameters. Parameters are
+    added once, in the order of the caller's own enum, and are then referred
+    to by index.
+
+    process() renders each moving parameter's next numSamples values into its
+    ramp, one array per parameter in the caller's DSPStateArena. Stages then
+    read getRamp() for every channel instead of each channel stepping its own
+    smoother. A parameter at rest costs nothing: its ramp isn't touched and
+    isRamping() is false, so stages use the single value from
+    getCurrentValue().
+
+    Curves:
+    - linear: equal steps, reaching the target in exactly the ramp time
+    - multiplicative: equal ratios, for gains and frequencies (values must be > 0)
+    - onePole: exponential approach, which follows a knob being dragged
+      without restarting a ramp on every move
+*/
+class SmoothingEngine
+{
+public:
+    enum class Curve { linear, multiplicative, onePole };
+
+    SmoothingEngine() = default;
+
+    //==============================================================================
+    /** Call once per parameter, before prepare(). Returns the parameter's index. */
+    int addParameter (Curve curve, double rampSeconds, float initialValue)
+    {
+        Parameter parameter;
+        parameter.curve = curve;
+        parameter.rampSeconds = rampSeconds;
+        parameter.current = parameter.target = initialValue;
+
+        parameters.push_back (parameter);
+        return (int) parameters.size() - 1;
+    }
+
+    /** How many floats of arena prepare() wants: a ramp per parameter, each on its own cache line. */
+    size_t getRampStorageSize (int maxSamplesPerBlock) const noexcept
+    {
+        return parameters.size() * DSPStateArena::roundUpToCacheLine ((size_t) maxSamplesPerBlock);
+    }
+
+    /** Every ramp is sized to the largest block, in getRampStorageSize() floats of arena. */
+    void prepare (double newSampleRate, int maxSamplesPerBlock, float* rampMemory)
+    {
+        sampleRate = newSampleRate;
+        ramps = rampMemory;
+        rampStride = DSPStateArena::roundUpToCacheLine ((size_t) maxSamplesPerBlock);
+        maxSamples = maxSamplesPerBlock;
+
+        for (auto& parameter : parameters)
+        {
+            parameter.rampLength = jmax (1, roundToInt (parameter.rampSeconds * sampleRate));
+
+            // reaches 99% of the way in the ramp time
+            parameter.onePoleCoefficient = (float) (1.0 - std::exp (-4.6 / parameter.rampLength));
+        }
+
+        reset();
+    }
+
+    /** Jumps every parameter to its target. */
+    void reset() noexcept
+    {
+        for (auto& parameter : parameters)
+        {
+            parameter.current = parameter.target;
+            parameter.stepsLeft = 0;
+            parameter.rampedThisBlock = false;
+        }
+    }
+
+    //==============================================================================
+    void setTargetValue (int index, float newTarget) noexcept
+    {
+        auto& parameter = parameters[(size_t) index];
+
+        if (newTarget == parameter.target)
+            return;
+
+        parameter.target = newTarget;
+        parameter.stepsLeft = parameter.rampLength;
+
+        if (parameter.curve == Curve::linear)
+            parameter.step = (newTarget - parameter.current) / (float) parameter.stepsLeft;
+        else if (parameter.curve == Curve::multiplicative)
+            parameter.step = std::exp ((std::log (newTarget) - std::log (parameter.current)) / (float) parameter.stepsLeft);
+    }
+
+    void setCurrentAndTargetValue (int index, float newValue) noexcept
+    {
+        auto& parameter = parameters[(size_t) index];
+        parameter.current = parameter.target = newValue;
+        parameter.stepsLeft = 0;
+    }
+
+    float getTargetValue (int index) const noexcept      { return parameters[(size_t) index].target; }
+
+    /** True while the parameter still has somewhere to go. */
+    bool isSmoothing (int index) const noexcept          { return parameters[(size_t) index].stepsLeft > 0; }
+
+    //==============================================================================
+    /** Advances every parameter by numSamples, rendering the ramps of the ones that move. */
+    void process (int numSamples) noexcept
+    {
+        jassert (numSamples <= maxSamples);
+
+        for (size_t index = 0; index < parameters.size(); ++index)
+        {
+            auto& parameter = parameters[index];
+            parameter.rampedThisBlock = parameter.stepsLeft > 0;
+
+            if (parameter.rampedThisBlock)
+                renderRamp (parameter, ramps + index * rampStride, numSamples);
+        }
+    }
+
+    /** Whether the last process() call rendered a ramp for this parameter. */
+    bool isRamping (int index) const noexcept            { return parameters[(size_t) index].rampedThisBlock; }
+
+    /** Only valid when isRamping(). */
+    const float* getRamp (int index) const noexcept      { return ramps + (size_t) index * rampStride; }
+
+    /** The value at the end of the last processed block. */
+    float getCurrentValue (int index) const noexcept     { return parameters[(size_t) index].current; }
+
+    float getValueAt (int index, int sample) const noexcept
+    {
+        return isRamping (index) ? getRamp (index)[sample] : getCurrentValue (index);
+    }
+
+private:
+    //==============================================================================
+    struct Parameter
+    {
+        Curve curve = Curve::linear;
+        double rampSeconds = 0.05;
+        int rampLength = 1, stepsLeft = 0;
+        float current = 0.0f, target = 0.0f, step = 0.0f, onePoleCoefficient = 1.0f;
+        bool rampedThisBlock = false;
+    };
+
+    std::vector<Parameter> parameters;
+    float* ramps = nullptr;
+    size_t rampStride = 0;
+    int maxSamples = 0;
+    double sampleRate = 44100.0;
+
+    static void renderRamp (Parameter& parameter, float* ramp, int numSamples) noexcept
+    {
+        auto current = parameter.current;
+
+        if (parameter.curve == Curve::onePole)
+        {
+            auto target = parameter.target;
+            auto tolerance = 1.0e-4f * jmax (std::abs (target), 1.0e-3f);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                current += parameter.onePoleCoefficient * (target - current);
+                ramp[i] = current;
+            }
+
+            if (std::abs (target - current) < tolerance)
+            {
+                current = target;
+                parameter.stepsLeft = 0;
+            }
+        }
+        else
+        {
+            auto numSteps = jmin (numSamples, parameter.stepsLeft);
+            auto step = parameter.step;
+
+            if (parameter.curve == Curve::linear)
+                for (int i = 0; i < numSteps; ++i)
+                    ramp[i] = (current += step);
+            else
+                for (int i = 0; i < numSteps; ++i)
+                    ramp[i] = (current *= step);
+
+            parameter.stepsLeft -= numSteps;
+
+            // land exactly on the target, and hold it for the rest of the block
+            if (parameter.stepsLeft == 0)
+            {
+                current = parameter.target;
+
+                for (int i = jmax (0, numSteps - 1); i < numSamples; ++i)
+                    ramp[i] = current;
+            }
+        }
+
+        parameter.current = current;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SmoothingEngine)
+};
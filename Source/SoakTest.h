@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    SoakTest.h
+
+    Drives one instance the way an unkind host would, for as long as asked,
+    and keeps a histogram of how long every processBlock took.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Three threads share the processor, as they would in a host:
+
+    - an audio thread calls processBlock back to back with random block
+      sizes up to maxBlockSize, under the callback lock, in real time unless
+      realtime is off
+    - a parameter thread sets every parameter to random values in bursts,
+      the way automation and control surfaces do
+    - the message thread opens and closes the editor, reloads saved states
+      with setStateInformation while audio is running, and every so often
+      changes the sample rate through prepareToPlay, holding the callback
+      lock like AudioProcessorPlayer does
+
+    Every block's duration goes into a histogram with power-of-two buckets
+    in microseconds. A block that took longer than deadlineRatio times its
+    own length in real time is an outlier, and the first maxOutliersKept of
+    them are reported with when they happened; averages hide exactly these.
+
+    The races this is meant to shake out only show up reliably with a
+    build made with -fsanitize=thread; run --soak on one of those. The Linux
+    Makefile has a TSan configuration for it, which Projucer can't give its
+    own flags, so they go on the command line, for compiling and linking:
+
+        make CONFIG=TSan CFLAGS=-fsanitize=thread CXXFLAGS=-fsanitize=thread LDFLAGS=-fsanitize=thread
+        build/tsan/pluginTemplate --soak 600 --no-editor
+*/
+class SoakTest  : private Timer
+{
+public:
+    using ProcessorFactory = std::function<AudioProcessor*()>;
+
+    struct Options
+    {
+        double seconds = 3600.0;
+        double deadlineRatio = 1.0;
+        int maxBlockSize = 2048;
+        bool withEditor = true;
+        bool realtime = true;             // off: blocks run flat out, hours of audio in minutes
+    };
+
+    static constexpr int numBuckets = 24;           // 1 us up to 8 s
+    static constexpr int maxOutliersKept = 64;
+
+    SoakTest (ProcessorFactory factory, Options optionsToUse)
+        : processor (factory()), options (optionsToUse),
+          audioThread ("Soak audio", [this] (Thread& thread) { runAudio (thread); }),
+          parameterThread ("Soak parameters", [this] (Thread& thread) { runParameterStorms (thread); })
+    {
+        options.maxBlockSize = jmax (1, options.maxBlockSize);
+        outliers.reserve ((size_t) maxOutliersKept);
+    }
+
+    ~SoakTest() override
+    {
+        stopEverything();
+    }
+
+    //==============================================================================
+    /** Message thread only. onFinished gets whether no block was an outlier. */
+    void start (std::function<void (bool)> onFinished)
+    {
+        finished = std::move (onFinished);
+
+        processor->getStateInformation (savedState);
+        changeSampleRate();
+
+        startTicks = Time::getHighResolutionTicks();
+        audioThread.startThread (Thread::realtimeAudioPriority);
+        parameterThread.startThread();
+        startTimerHz (20);
+    }
+
+private:
+    //==============================================================================
+    struct Outlier
+    {
+        double atSeconds, sampleRate, ratio;
+        int numSamples;
+    };
+
+    /** A Thread that runs a function, which is handed the thread to check for exit. */
+    struct Worker  : public Thread
+    {
+        Worker (const String& name, std::function<void (Thread&)> bodyToUse)
+            : Thread (name), body (std::move (bodyToUse)) {}
+
+        void run() override     { body (*this); }
+
+        std::function<void (Thread&)> body;
+    };
+
+    std::unique_ptr<AudioProcessor> processor;
+    std::unique_ptr<AudioProcessorEditor> editor;
+    Options options;
+    Worker audioThread, parameterThread;
+    std::function<void (bool)> finished;
+    Random random;
+
+    // set under the callback lock
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+
+    // the audio thread's alone until it's stopped
+    int64 histogram[numBuckets] {};
+    int64 numBlocks = 0, numOutliers = 0;
+    double worstRatio = 0.0, totalMicroseconds = 0.0;
+    std::vector<Outlier> outliers;
+
+    std::atomic<int64> blocksDone { 0 };
+    MemoryBlock savedState;
+    int64 startTicks = 0;
+    double nextRateChange = 0.0, nextProgressLog = 60.0;
+
+    double getElapsedSeconds() const
+    {
+        return Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks);
+    }
+
+    //==============================================================================
+    void runAudio (Thread& thread)
+    {
+        Random audioRandom;
+        AudioBuffer<float> buffer;
+        MidiBuffer midi;
+        auto audioSeconds = 0.0;
+
+        // the largest block up front, so nothing is allocated in the timed loop
+        {
+            const ScopedLock sl (processor->getCallbackLock());
+            buffer.setSize (numChannels, options.maxBlockSize);
+        }
+
+        while (! thread.threadShouldExit())
+        {
+            // mostly the sizes hosts like, sometimes anything at all
+            auto numSamples = audioRandom.nextBool()
+                                ? jmin (options.maxBlockSize, 16 << audioRandom.nextInt (8))
+                                : 1 + audioRandom.nextInt (options.maxBlockSize);
+            double rate;
+            int64 ticks;
+
+            {
+                const ScopedLock sl (processor->getCallbackLock());
+
+                rate = sampleRate;
+                buffer.setSize (numChannels, numSamples, false, false, true);
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                    for (int i = 0; i < numSamples; ++i)
+                        buffer.setSample (channel, i, audioRandom.nextFloat() - 0.5f);
+
+                auto blockStart = Time::getHighResolutionTicks();
+                processor->processBlock (buffer, midi);
+                ticks = Time::getHighResolutionTicks() - blockStart;
+            }
+
+            recordBlock (Time::highResolutionTicksToSeconds (ticks), numSamples, rate);
+            audioSeconds += numSamples / rate;
+
+            // keep to real time, roughly; waking a millisecond late only makes the next block early
+            if (options.realtime)
+                while (! thread.threadShouldExit() && getElapsedSeconds() < audioSeconds - 0.002)
+                    thread.wait (1);
+        }
+    }
+
+    void recordBlock (double seconds, int numSamples, double rate)
+    {
+        auto microseconds = seconds * 1.0e6;
+        auto bucket = microseconds < 2.0 ? 0 : jmin (numBuckets - 1, (int) std::log2 (microseconds));
+        auto ratio = seconds * rate / numSamples;
+
+        ++histogram[bucket];
+        ++numBlocks;
+        totalMicroseconds += microseconds;
+        worstRatio = jmax (worstRatio, ratio);
+
+        if (ratio > options.deadlineRatio)
+        {
+            ++numOutliers;
+
+            if (outliers.size() < (size_t) maxOutliersKept)
+                outliers.push_back ({ getElapsedSeconds(), rate, ratio, numSamples });
+        }
+
+        blocksDone.store (numBlocks, std::memory_order_relaxed);
+    }
+
+    void runParameterStorms (Thread& thread)
+    {
+        Random stormRandom;
+        auto& parameters = processor->getParameters();
+
+        while (! thread.threadShouldExit())
+        {
+            // a burst of a few hundred changes over a tenth of a second, then a random lull
+            for (int i = 0; i < 400 && ! thread.threadShouldExit(); ++i)
+            {
+                if (auto* parameter = parameters[stormRandom.nextInt (parameters.size())])
+                    parameter->setValueNotifyingHost (stormRandom.nextFloat());
+
+                if (i % 4 == 0)
+                    thread.wait (1);
+            }
+
+            thread.wait (stormRandom.nextInt (2000));
+        }
+    }
+
+    //==============================================================================
+    void timerCallback() override
+    {
+        auto elapsed = getElapsedSeconds();
+
+        if (elapsed >= options.seconds)
+        {
+            finish();
+            return;
+        }
+
+        // about twice a second the editor goes, or comes back
+        if (options.withEditor && random.nextInt (10) == 0)
+        {
+            if (editor != nullptr)
+                editor = nullptr;
+            else
+                editor.reset (processor->createEditorIfNeeded());
+        }
+
+        // every couple of seconds a preset load, sometimes of whatever is playing now
+        if (random.nextInt (40) == 0)
+        {
+            if (random.nextBool())
+                processor->getStateInformation (savedState);
+
+            processor->setStateInformation (savedState.getData(), (int) savedState.getSize());
+        }
+
+        if (elapsed >= nextRateChange)
+        {
+            changeSampleRate();
+            nextRateChange = elapsed + 10.0 + random.nextInt (50);
+        }
+
+        if (elapsed >= nextProgressLog)
+        {
+            Logger::writeToLog ("Soak: " + String (roundToInt (elapsed / 60.0)) + " min, "
+                                 + String (blocksDone.load()) + " blocks");
+            nextProgressLog += 60.0;
+        }
+    }
+
+    void changeSampleRate()
+    {
+        static const double rates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0 };
+        auto newRate = rates[random.nextInt (numElementsInArray (rates))];
+
+        const ScopedLock sl (processor->getCallbackLock());
+
+        processor->releaseResources();
+        processor->setRateAndBufferSizeDetails (newRate, options.maxBlockSize);
+        processor->prepareToPlay (newRate, options.maxBlockSize);
+
+        sampleRate = newRate;
+        numChannels = jmax (1, processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+    }
+
+    void stopEverything()
+    {
+        stopTimer();
+        audioThread.stopThread (5000);
+        parameterThread.stopThread (5000);
+        editor = nullptr;
+
+        if (processor != nullptr)
+            processor->releaseResources();
+    }
+
+    void finish()
+    {
+        stopEverything();
+
+        Logger::writeToLog ("Soak: " + String (numBlocks) + " blocks over " + String (getElapsedSeconds() / 60.0, 1)
+                             + " min, " + String (totalMicroseconds / jmax ((int64) 1, numBlocks), 1) + " us on average, worst "
+                             + String (worstRatio, 3) + " of its deadline");
+
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+            if (histogram[bucket] > 0)
+                Logger::writeToLog ("  " + String (bucket == 0 ? 0 : 1 << bucket) + " - " + String (2 << bucket) + " us: "
+                                     + String (histogram[bucket]));
+
+        Logger::writeToLog (String (numOutliers) + " blocks over " + String (options.deadlineRatio, 2) + " of their deadline");
+
+        for (auto& outlier : outliers)
+            Logger::writeToLog ("  at " + String (outlier.atSeconds, 1) + " s: " + String (outlier.numSamples) + " samples at "
+                                 + String (outlier.sampleRate / 1000.0, 1) + " kHz took " + String (outlier.ratio, 3)
+                                 + " of the deadline");
+
+        if (finished != nullptr)
+            finished (numOutliers == 0);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SoakTest)
+};
@@ -0,0 +1,702 @@
+/*
+  ==============================================================================
+
+    StandaloneApp.cpp
+
+    Replaces JUCE's default standalone application so live rigs can run at
+    32-64 sample buffers on Linux ALSA/JACK without dropouts. AppConfig.h
+    turns it on through JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP, for the Linux
+    Makefile exporter only; the other exporters keep JUCE's own app.
+
+    Started as "--render <input> <output>" it opens no window and bounces
+    the file with the last saved settings instead, on every core.
+
+    Started as "--serve [port] [threads]" it opens no window either, and
+    runs a DSPServer for other local processes until it's told to quit.
+    "--serve-benchmark [port] [clients] [seconds]" streams noise through
+    a running server from several clients at once and logs the throughput.
+
+    "--benchmark-instances [count] [block size] [--editors]" loads a big
+    template's worth of instances and logs what each costs to scan,
+    construct, prepare, keep in memory and process.
+
+    "--soak [seconds] [deadline ratio] [--fast] [--no-editor]" plays one
+    instance while a host's worth of other threads interfere, and logs a
+    histogram of processBlock times with every block that ran late.
+
+    "--xrun-test [seconds] [buffer size] [--jack]" opens the audio device
+    the window last used, or JACK, with no window, plays through the plugin
+    for a minute or as long as asked, and exits with 1 if anything ran late.
+    Against JACK's dummy backend: jackd -d dummy -r 48000 -p 32, then
+    --xrun-test 600 32 --jack.
+
+    "--selftest" checks ProcessorChain's fused per-sample runs, then every
+    SIMD kernel and the whole processor with its parameters swept against
+    the scalar ones at every instruction set the CPU has, and exits with 1
+    if any of them disagree.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#if JucePlugin_Build_Standalone && JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP
+
+#include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
+#include "ParallelRenderer.h"
+#include "DSPServer.h"
+#include "DSPClient.h"
+#include "KernelSelfTest.h"
+#include "InstanceBenchmark.h"
+#include "SoakTest.h"
+
+#if JUCE_LINUX
+ #include <pthread.h>
+ #include <sched.h>
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+/**
+    Sits next to the plugin on the audio device and gets the audio thread and
+    the process ready for small buffers:
+
+    - the first callback on a new device moves its thread to SCHED_FIFO (JACK
+      threads are already real-time and are left alone) and touches a chunk of
+      stack, so the audio thread never takes a page fault for it later
+    - every time the device starts, the plugin is run over a few thousand
+      samples of silence, which faults in all of its buffers, FFT tables and
+      filter state before the first real block, and is then reset
+    - xruns are counted, from the driver when it reports them and otherwise
+      from callbacks that arrive much later than one buffer period
+
+    JUCE's CriticalSection already uses priority-inheriting mutexes on Linux,
+    so the processor's callback lock can't cause a priority inversion.
+*/
+class LowLatencyTuning  : public AudioIODeviceCallback
+{
+public:
+    static constexpr int realtimePriority = 70;
+    static constexpr int stackPrefaultBytes = 64 * 1024;
+    static constexpr int warmUpSamples = 8192;      // a few passes over every convolution partition
+    static constexpr int settleCallbacks = 16;      // starting a device is allowed a glitch or two
+
+    explicit LowLatencyTuning (StandalonePluginHolder& holderToUse)
+        : holder (holderToUse)
+    {
+        holder.deviceManager.addAudioCallback (this);
+    }
+
+    ~LowLatencyTuning() override
+    {
+        holder.deviceManager.removeAudioCallback (this);
+    }
+
+    //==============================================================================
+    /** Locks the process's memory so nothing the audio thread touches can be
+        paged out. With MCL_FUTURE every later allocation is faulted in as it
+        is made, which is only safe when the memlock limit can't be hit.
+    */
+    static void lockProcessMemory()
+    {
+       #if JUCE_LINUX
+        rlimit limit {};
+
+        if (geteuid() != 0 && (getrlimit (RLIMIT_MEMLOCK, &limit) != 0 || limit.rlim_cur != RLIM_INFINITY))
+        {
+            Logger::writeToLog ("Memory not locked: set 'memlock unlimited' for this user in /etc/security/limits.conf");
+            return;
+        }
+
+        if (mlockall (MCL_CURRENT | MCL_FUTURE) != 0)
+            Logger::writeToLog ("mlockall failed: " + String (strerror (errno)));
+       #endif
+    }
+
+    int getNumXRuns() const noexcept             { return xRuns.load(); }
+    bool hasRealtimePriority() const noexcept    { return realtimeThread.load(); }
+
+    //==============================================================================
+    void audioDeviceAboutToStart (AudioIODevice* device) override
+    {
+        // the holder registered first, so the plugin has already been prepared
+        if (auto* processor = holder.processor.get())
+            warmUp (*processor, device->getCurrentBufferSizeSamples());
+
+        periodTicks = Time::secondsToHighResolutionTicks (device->getCurrentBufferSizeSamples()
+                                                            / device->getCurrentSampleRate());
+        currentDevice = device;
+        numCallbacks = 0;
+        lastCallbackTicks = 0;
+        lateCallbacks = 0;
+        xRuns.store (0);
+    }
+
+    void audioDeviceStopped() override
+    {
+        currentDevice = nullptr;
+    }
+
+    void audioDeviceIOCallback (const float**, int, float** outputChannelData,
+                                int numOutputChannels, int numSamples) override
+    {
+        // anything we leave in the outputs gets mixed into the plugin's signal
+        for (int channel = 0; channel < numOutputChannels; ++channel)
+            if (outputChannelData[channel] != nullptr)
+                FloatVectorOperations::clear (outputChannelData[channel], numSamples);
+
+        if (numCallbacks == 0)
+        {
+            realtimeThread.store (promoteCurrentThread());
+            prefaultStack();
+        }
+
+        auto now = Time::getHighResolutionTicks();
+
+        if (lastCallbackTicks != 0 && now - lastCallbackTicks > periodTicks + periodTicks / 2)
+            ++lateCallbacks;
+
+        lastCallbackTicks = now;
+
+        if (++numCallbacks == settleCallbacks)
+        {
+            xRunBaseline = currentDevice->getXRunCount();
+            lateCallbacks = 0;
+        }
+
+        if (numCallbacks >= settleCallbacks)
+        {
+            // getXRunCount() is -1 when the driver doesn't report them
+            auto reported = currentDevice->getXRunCount();
+            xRuns.store (reported >= 0 && xRunBaseline >= 0 ? reported - xRunBaseline : lateCallbacks);
+        }
+    }
+
+private:
+    //==============================================================================
+    StandalonePluginHolder& holder;
+    AudioIODevice* currentDevice = nullptr;
+    int64 periodTicks = 0, lastCallbackTicks = 0;
+    int numCallbacks = 0, lateCallbacks = 0, xRunBaseline = -1;
+
+    std::atomic<int> xRuns { 0 };
+    std::atomic<bool> realtimeThread { false };
+
+    static void warmUp (AudioProcessor& processor, int blockSize)
+    {
+        blockSize = jmax (1, blockSize);
+
+        AudioBuffer<float> silence (jmax (processor.getTotalNumInputChannels(),
+                                          processor.getTotalNumOutputChannels()), blockSize);
+        MidiBuffer midi;
+
+        const ScopedLock sl (processor.getCallbackLock());
+
+        for (int done = 0; done < warmUpSamples; done += blockSize)
+        {
+            silence.clear();
+            processor.processBlock (silence, midi);
+        }
+
+        processor.reset();
+    }
+
+    static bool promoteCurrentThread() noexcept
+    {
+       #if JUCE_LINUX
+        int policy = 0;
+        sched_param param {};
+
+        if (pthread_getschedparam (pthread_self(), &policy, &param) == 0
+             && (policy == SCHED_FIFO || policy == SCHED_RR))
+            return true;
+
+        param.sched_priority = realtimePriority;
+        return pthread_setschedparam (pthread_self(), SCHED_FIFO, &param) == 0;
+       #else
+        return true;
+       #endif
+    }
+
+    static void prefaultStack() noexcept
+    {
+        volatile char stack[stackPrefaultBytes];
+
+        for (int i = 0; i < stackPrefaultBytes; i += 1024)
+            stack[i] = 0;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowLatencyTuning)
+};
+
+//==============================================================================
+/** The stock standalone window, with the xrun count in its title bar. */
+class LowLatencyFilterWindow  : public StandaloneFilterWindow,
+                                private Timer
+{
+public:
+    LowLatencyFilterWindow (const String& title, PropertySet* settings,
+                            const AudioDeviceManager::AudioDeviceSetup* preferredSetup,
+                            const Array<StandalonePluginHolder::PluginInOuts>& channels)
+        : StandaloneFilterWindow (title,
+                                  LookAndFeel::getDefaultLookAndFeel().findColour (ResizableWindow::backgroundColourId),
+                                  settings, false, {}, preferredSetup, channels),
+          appName (title)
+    {
+        if (auto* holder = getPluginHolder())
+            tuning = std::make_unique<LowLatencyTuning> (*holder);
+
+        startTimer (500);
+    }
+
+    ~LowLatencyFilterWindow() override
+    {
+        stopTimer();
+        tuning = nullptr;
+    }
+
+private:
+    String appName;
+    std::unique_ptr<LowLatencyTuning> tuning;
+
+    void timerCallback() override
+    {
+        if (tuning == nullptr)
+            return;
+
+        auto title = appName + " - xruns: " + String (tuning->getNumXRuns());
+
+        if (! tuning->hasRealtimePriority())
+            title << " (no real-time priority)";
+
+        if (getName() != title)
+            setName (title);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LowLatencyFilterWindow)
+};
+
+//==============================================================================
+/** The standalone's audio path without its window: the same holder and
+    tuning, for a fixed time, then a verdict on the xruns.
+*/
+class XRunTest  : private Timer
+{
+public:
+    XRunTest (PropertySet* settings, const Array<StandalonePluginHolder::PluginInOuts>& channelConfigs,
+              double secondsToRun, int bufferSize, bool useJack, std::function<void (bool)> onFinished)
+        : seconds (secondsToRun), finished (std::move (onFinished))
+    {
+        holder = std::make_unique<StandalonePluginHolder> (settings, false, String(), nullptr, channelConfigs);
+        auto& deviceManager = holder->deviceManager;
+
+        if (useJack)
+            deviceManager.setCurrentAudioDeviceType ("JACK", true);
+
+        auto setup = deviceManager.getAudioDeviceSetup();
+        setup.bufferSize = bufferSize;
+        auto error = deviceManager.setAudioDeviceSetup (setup, true);
+
+        if (error.isNotEmpty() || deviceManager.getCurrentAudioDevice() == nullptr)
+        {
+            Logger::writeToLog ("No audio device: " + error);
+            fail = true;
+        }
+        else
+        {
+            // added after the holder, like the window does, so the plugin is prepared before the warm-up
+            tuning = std::make_unique<LowLatencyTuning> (*holder);
+        }
+
+        startTicks = Time::getHighResolutionTicks();
+        startTimer (500);
+    }
+
+    ~XRunTest() override
+    {
+        stopTimer();
+        tuning = nullptr;
+        holder = nullptr;
+    }
+
+private:
+    std::unique_ptr<StandalonePluginHolder> holder;
+    std::unique_ptr<LowLatencyTuning> tuning;
+    double seconds;
+    std::function<void (bool)> finished;
+    int64 startTicks = 0;
+    bool fail = false;
+
+    void timerCallback() override
+    {
+        if (! fail && Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - startTicks) < seconds)
+            return;
+
+        stopTimer();
+        auto passed = ! fail;
+
+        if (auto* device = holder->deviceManager.getCurrentAudioDevice())
+        {
+            auto numXRuns = tuning != nullptr ? tuning->getNumXRuns() : 0;
+            passed = passed && numXRuns == 0;
+
+            Logger::writeToLog (device->getTypeName() + " \"" + device->getName() + "\", "
+                                 + String (device->getCurrentBufferSizeSamples()) + " samples at "
+                                 + String (device->getCurrentSampleRate() / 1000.0, 1) + " kHz for "
+                                 + String (seconds, 0) + " s: " + String (numXRuns) + " xruns"
+                                 + (tuning != nullptr && tuning->hasRealtimePriority() ? String() : String (", no real-time priority")));
+        }
+
+        if (finished != nullptr)
+            finished (passed);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (XRunTest)
+};
+
+//==============================================================================
+/** Same as JUCE's StandaloneFilterApp apart from the window it creates,
+    locking memory at startup and defaulting to a 64 sample buffer.
+*/
+class LowLatencyStandaloneApp  : public JUCEApplication
+{
+public:
+    static constexpr int defaultBufferSize = 64;
+
+    LowLatencyStandaloneApp()
+    {
+        PluginHostType::jucePlugInClientCurrentWrapperType = AudioProcessor::wrapperType_Standalone;
+
+        PropertiesFile::Options options;
+        options.applicationName     = getApplicationName();
+        options.filenameSuffix      = ".settings";
+        options.osxLibrarySubFolder = "Application Support";
+       #if JUCE_LINUX
+        options.folderName          = "~/.config";
+       #else
+        options.folderName          = "";
+       #endif
+
+        appProperties.setStorageParameters (options);
+    }
+
+    const String getApplicationName() override              { return JucePlugin_Name; }
+    const String getApplicationVersion() override           { return JucePlugin_VersionString; }
+    bool moreThanOneInstanceAllowed() override              { return true; }
+    void anotherInstanceStarted (const String&) override    {}
+
+    void initialise (const String& commandLine) override
+    {
+        StringArray arguments;
+        arguments.addTokens (commandLine, true);
+        arguments.trim();
+
+        auto renderIndex = arguments.indexOf ("--render");
+
+        if (renderIndex >= 0)
+        {
+            setApplicationReturnValue (renderFile (arguments[renderIndex + 1].unquoted(),
+                                                   arguments[renderIndex + 2].unquoted()) ? 0 : 1);
+            quit();
+            return;
+        }
+
+        if (arguments.contains ("--selftest"))
+        {
+            setApplicationReturnValue (KernelSelfTest::run() ? 0 : 1);
+            quit();
+            return;
+        }
+
+        auto serveIndex = arguments.indexOf ("--serve");
+
+        if (serveIndex >= 0)
+        {
+            auto port = arguments[serveIndex + 1].getIntValue();
+            server = std::make_unique<DSPServer> ([] { return createPluginFilterOfType (AudioProcessor::wrapperType_Standalone); },
+                                                  arguments[serveIndex + 2].getIntValue());
+
+            if (! server->start (port > 0 ? port : DSPServer::defaultPort))
+            {
+                Logger::writeToLog ("Can't listen on port " + String (port > 0 ? port : DSPServer::defaultPort));
+                setApplicationReturnValue (1);
+                quit();
+            }
+
+            return;
+        }
+
+        auto benchmarkIndex = arguments.indexOf ("--serve-benchmark");
+
+        if (benchmarkIndex >= 0)
+        {
+            auto port = arguments[benchmarkIndex + 1].getIntValue();
+            auto numClients = arguments[benchmarkIndex + 2].getIntValue();
+            auto seconds = arguments[benchmarkIndex + 3].getDoubleValue();
+
+            setApplicationReturnValue (benchmarkServer (port > 0 ? port : DSPServer::defaultPort,
+                                                        numClients > 0 ? numClients : SystemStats::getNumCpus(),
+                                                        seconds > 0.0 ? seconds : 10.0) ? 0 : 1);
+            quit();
+            return;
+        }
+
+        auto instancesIndex = arguments.indexOf ("--benchmark-instances");
+
+        if (instancesIndex >= 0)
+        {
+            InstanceBenchmark::Options options;
+            options.withEditors = arguments.contains ("--editors");
+
+            auto numInstances = arguments[instancesIndex + 1].getIntValue();
+            auto blockSize = arguments[instancesIndex + 2].getIntValue();
+
+            if (numInstances > 0)   options.numInstances = numInstances;
+            if (blockSize > 0)      options.blockSize = blockSize;
+
+            MemoryBlock state;
+
+            if (auto* settings = appProperties.getUserSettings())
+                state.fromBase64Encoding (settings->getValue ("filterState"));
+
+            InstanceBenchmark benchmark ([] { return createPluginFilterOfType (AudioProcessor::wrapperType_Standalone); },
+                                         state, options);
+            benchmark.run();
+
+            quit();
+            return;
+        }
+
+        auto soakIndex = arguments.indexOf ("--soak");
+
+        if (soakIndex >= 0)
+        {
+            SoakTest::Options options;
+            options.realtime = ! arguments.contains ("--fast");
+            options.withEditor = ! arguments.contains ("--no-editor");
+
+            auto seconds = arguments[soakIndex + 1].getDoubleValue();
+            auto deadlineRatio = arguments[soakIndex + 2].getDoubleValue();
+
+            if (seconds > 0.0)          options.seconds = seconds;
+            if (deadlineRatio > 0.0)    options.deadlineRatio = deadlineRatio;
+
+            soakTest = std::make_unique<SoakTest> ([] { return createPluginFilterOfType (AudioProcessor::wrapperType_Standalone); },
+                                                   options);
+            soakTest->start ([this] (bool passed)
+            {
+                setApplicationReturnValue (passed ? 0 : 1);
+                quit();
+            });
+
+            return;
+        }
+
+        // before the window or the test's holder exists, so the plugin and device buffers are locked as they're allocated
+        LowLatencyTuning::lockProcessMemory();
+
+        // only used until the user picks their own settings in the audio setup dialog
+        AudioDeviceManager::AudioDeviceSetup preferredSetup;
+        preferredSetup.bufferSize = defaultBufferSize;
+
+       #ifdef JucePlugin_PreferredChannelConfigurations
+        StandalonePluginHolder::PluginInOuts channels[] = { JucePlugin_PreferredChannelConfigurations };
+        Array<StandalonePluginHolder::PluginInOuts> channelConfigs (channels, numElementsInArray (channels));
+       #else
+        Array<StandalonePluginHolder::PluginInOuts> channelConfigs;
+       #endif
+
+        auto xRunIndex = arguments.indexOf ("--xrun-test");
+
+        if (xRunIndex >= 0)
+        {
+            auto seconds = arguments[xRunIndex + 1].getDoubleValue();
+            auto bufferSize = arguments[xRunIndex + 2].getIntValue();
+
+            xRunTest = std::make_unique<XRunTest> (appProperties.getUserSettings(), channelConfigs,
+                                                   seconds > 0.0 ? seconds : 60.0,
+                                                   bufferSize > 0 ? bufferSize : defaultBufferSize,
+                                                   arguments.contains ("--jack"),
+                                                   [this] (bool passed)
+                                                   {
+                                                       setApplicationReturnValue (passed ? 0 : 1);
+                                                       quit();
+                                                   });
+            return;
+        }
+
+        mainWindow = std::make_unique<LowLatencyFilterWindow> (getApplicationName(), appProperties.getUserSettings(),
+                                                               &preferredSetup, channelConfigs);
+        mainWindow->setVisible (true);
+    }
+
+    void shutdown() override
+    {
+        soakTest = nullptr;
+        xRunTest = nullptr;
+        server = nullptr;
+        mainWindow = nullptr;
+        appProperties.saveIfNeeded();
+    }
+
+    void systemRequestedQuit() override
+    {
+        if (mainWindow != nullptr)
+            mainWindow->pluginHolder->savePluginState();
+
+        if (ModalComponentManager::getInstance()->cancelAllModalComponents())
+        {
+            Timer::callAfterDelay (100, []()
+            {
+                if (auto app = JUCEApplicationBase::getInstance())
+                    app->systemRequestedQuit();
+            });
+        }
+        else
+        {
+            quit();
+        }
+    }
+
+private:
+    ApplicationProperties appProperties;
+    std::unique_ptr<LowLatencyFilterWindow> mainWindow;
+    std::unique_ptr<DSPServer> server;
+    std::unique_ptr<SoakTest> soakTest;
+    std::unique_ptr<XRunTest> xRunTest;
+
+    /** Uses whatever state the standalone window last saved. */
+    bool renderFile (const String& inputPath, const String& outputPath)
+    {
+        if (inputPath.isEmpty() || outputPath.isEmpty())
+        {
+            Logger::writeToLog ("Usage: --render <input file> <output file>");
+            return false;
+        }
+
+        MemoryBlock state;
+
+        if (auto* settings = appProperties.getUserSettings())
+            state.fromBase64Encoding (settings->getValue ("filterState"));
+
+        auto input = File::getCurrentWorkingDirectory().getChildFile (inputPath);
+        auto output = File::getCurrentWorkingDirectory().getChildFile (outputPath);
+
+        ParallelRenderer renderer ([] { return createPluginFilterOfType (AudioProcessor::wrapperType_Standalone); },
+                                   state, {});
+
+        auto lastPercent = -1;
+        auto result = renderer.render (input, output, [&lastPercent] (double progress)
+        {
+            auto percent = roundToInt (progress * 100.0);
+
+            if (percent / 10 != lastPercent / 10)
+                Logger::writeToLog ("Rendered " + String (percent) + "%");
+
+            lastPercent = percent;
+            return true;
+        });
+
+        if (result.failed())
+            Logger::writeToLog (result.getErrorMessage());
+
+        return result.wasOk();
+    }
+
+    /** Every client keeps its whole ring in flight, so this measures the server
+        flat out, with the last saved settings and a bounce's quality.
+    */
+    bool benchmarkServer (int port, int numClients, double seconds)
+    {
+        DSPClient::Options options;
+
+        if (auto* settings = appProperties.getUserSettings())
+            options.state.fromBase64Encoding (settings->getValue ("filterState"));
+
+        std::atomic<int64> totalSamples { 0 };
+        std::atomic<int> numRunning { numClients };
+        std::atomic<bool> failed { false };
+        WaitableEvent allFinished;
+
+        auto startTime = Time::getMillisecondCounterHiRes();
+        auto endTime = startTime + seconds * 1000.0;
+        ThreadPool pool (numClients);
+
+        for (int i = 0; i < numClients; ++i)
+        {
+            pool.addJob ([&]
+            {
+                DSPClient client;
+                auto result = client.connect (port, options);
+                int64 numSamples = 0;
+
+                if (result.failed())
+                {
+                    Logger::writeToLog (result.getErrorMessage());
+                    failed.store (true);
+                }
+
+                Random random;
+                int numProcessed;
+
+                while (result.wasOk() && Time::getMillisecondCounterHiRes() < endTime)
+                {
+                    if (auto* channels = client.getNextBlock())
+                    {
+                        for (int channel = 0; channel < client.getNumChannels(); ++channel)
+                            for (int n = 0; n < client.getMaxBlockSize(); ++n)
+                                channels[channel][n] = random.nextFloat() * 2.0f - 1.0f;
+
+                        if (! client.submitBlock (client.getMaxBlockSize()))
+                            result = Result::fail ("Lost the server");
+                    }
+                    else if (client.waitForProcessedBlock (numProcessed, 5000) != nullptr)
+                    {
+                        numSamples += numProcessed;
+                    }
+                    else
+                    {
+                        result = Result::fail ("Lost the server");
+                    }
+                }
+
+                while (result.wasOk() && client.getNumBlocksInFlight() > 0)
+                {
+                    if (client.waitForProcessedBlock (numProcessed, 5000) == nullptr)
+                        result = Result::fail ("Lost the server");
+
+                    numSamples += numProcessed;
+                }
+
+                if (result.failed())
+                    failed.store (true);
+
+                totalSamples += numSamples;
+
+                if (--numRunning == 0)
+                    allFinished.signal();
+            });
+        }
+
+        allFinished.wait();
+
+        auto elapsed = (Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+        auto samplesPerSecond = (double) totalSamples.load() / elapsed;
+
+        Logger::writeToLog (String (numClients) + " clients, " + String (options.maxBlockSize) + " sample blocks, "
+                             + String (options.numSlots) + " in flight each: "
+                             + String (samplesPerSecond / 1.0e6, 2) + " Msamples/s per channel, "
+                             + String (samplesPerSecond / options.sampleRate, 1) + "x realtime at "
+                             + String (options.sampleRate / 1000.0, 1) + " kHz");
+
+        return ! failed.load();
+    }
+};
+
+//==============================================================================
+JUCEApplicationBase* juce_CreateApplication();
+JUCEApplicationBase* juce_CreateApplication()    { return new LowLatencyStandaloneApp(); }
+
+#endif
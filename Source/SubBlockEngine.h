@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    SubBlockEngine.h
+
+    Splits host buffers of any size into fixed-size internal chunks and owns
+    the scratch memory the DSP stages work in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPStateArena.h"
+
+//==============================================================================
+/**
+    Host buffers can be anything from 1 sample to far more than announced in
+    prepareToPlay, so the processing chain never sees them directly. Instead
+    process() walks the buffer in chunks of at most getSubBlockSize() samples,
+    which keeps the working set of every stage small enough to stay in L1/L2.
+
+    All scratch memory is sized from the announced block size, and lives in the
+    caller's DSPStateArena; the audio thread only ever hands out pointers into
+    it. Each buffer starts on a cache line of its own.
+*/
+class SubBlockEngine
+{
+public:
+    /** Largest chunk we process in one go: 256 floats is 1 KB per channel. */
+    static constexpr int maxSubBlockSize = 256;
+    static constexpr int maxChannels = 2;
+
+    SubBlockEngine() = default;
+
+    //==============================================================================
+    static int getSubBlockSizeFor (int samplesPerBlock) noexcept
+    {
+        return jlimit (1, maxSubBlockSize, samplesPerBlock);
+    }
+
+    /** How many floats of arena prepare() wants for this many buffers per channel. */
+    static size_t getScratchSize (int samplesPerBlock, int numScratchBuffers) noexcept
+    {
+        return (size_t) (maxChannels * jmax (1, numScratchBuffers))
+                 * DSPStateArena::roundUpToCacheLine ((size_t) getSubBlockSizeFor (samplesPerBlock));
+    }
+
+    /** Called from prepareToPlay, with getScratchSize() floats of arena that stay valid until the next call. */
+    void prepare (int numChannels, int samplesPerBlock, int numScratchBuffers, float* scratchMemory)
+    {
+        jassert (numChannels <= maxChannels);
+
+        subBlockSize = getSubBlockSizeFor (samplesPerBlock);
+        scratchBuffersPerChannel = jmax (1, numScratchBuffers);
+        scratchStride = DSPStateArena::roundUpToCacheLine ((size_t) subBlockSize);
+        scratch = scratchMemory;
+    }
+
+    int getSubBlockSize() const noexcept            { return subBlockSize; }
+
+    /** Returns a sub-block sized work area for a stage. Contents are undefined
+        on entry and only valid for the duration of the current chunk.
+    */
+    float* getScratch (int index, int channel) noexcept
+    {
+        jassert (isPositiveAndBelow (index, scratchBuffersPerChannel));
+        jassert (isPositiveAndBelow (channel, maxChannels));
+
+        return scratch + (size_t) (channel * scratchBuffersPerChannel + index) * scratchStride;
+    }
+
+    //==============================================================================
+    /** Calls subBlockFunction (float* const* channels, int numChannels, int numSamples)
+        once per chunk, with the channel pointers offset into the host buffer.
+    */
+    template <typename SubBlockFunction>
+    void process (AudioBuffer<float>& buffer, int numChannels, SubBlockFunction&& subBlockFunction)
+    {
+        jassert (numChannels <= maxChannels);
+
+        auto numSamples = buffer.getNumSamples();
+        float* channels[maxChannels] = {};
+
+        for (int offset = 0; offset < numSamples; offset += subBlockSize)
+        {
+            auto numThisTime = jmin (subBlockSize, numSamples - offset);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[channel] = buffer.getWritePointer (channel, offset);
+
+            subBlockFunction (channels, numChannels, numThisTime);
+        }
+    }
+
+private:
+    float* scratch { nullptr };
+    size_t scratchStride { 0 };
+    int subBlockSize { maxSubBlockSize };
+    int scratchBuffersPerChannel { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SubBlockEngine)
+};
@@ -0,0 +1,371 @@
+/*
+  ==============================================================================
+
+    Waveshaper.h
+
+    The output clipper's curves (hard, tanh, cubic, asymmetric tube), with
+    optional first or second order antiderivative anti-aliasing (ADAA).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSPKernels.h"
+
+//==============================================================================
+/**
+    A curve f together with its first and second antiderivatives F1 and F2,
+    tabulated for curves that would otherwise need a transcendental call per
+    sample. Nodes are 1/32 apart over [-range, range]; F2 uses quintic Hermite
+    interpolation from (F2, F1, f) at each node and F1 from (F1, f, f'), so
+    both are smooth across nodes and their difference quotients stay clean.
+
+    The curves saturate by +-range, so outside it f is constant and F1, F2
+    carry on as a line and a parabola.
+*/
+class WaveshaperTable
+{
+public:
+    static constexpr double range = 10.0;
+    static constexpr int pointsPerUnit = 32;
+    static constexpr int numPoints = (int) (2 * range * pointsPerUnit) + 1;
+
+    /** Integrates curve numerically; only ever done once per curve, off the audio thread. */
+    explicit WaveshaperTable (const std::function<double (double)>& curve)
+    {
+        auto h = 1.0 / pointsPerUnit;
+        auto centre = numPoints / 2;
+
+        for (int i = 0; i < numPoints; ++i)
+        {
+            auto x = (i - centre) * h;
+            nodes[(size_t) i].f = curve (x);
+            nodes[(size_t) i].slope = (curve (x + 1.0e-5) - curve (x - 1.0e-5)) / 2.0e-5;
+        }
+
+        // F1 = int f, and F2 = x F1 - int t f(t), outwards from 0 with 5-point Gauss-Legendre per step
+        static const double abscissae[] = { -0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640 };
+        static const double weights[]   = {  0.2369268850561891,  0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891 };
+
+        auto integrateStep = [&] (double from, double to, double& integral, double& momentIntegral)
+        {
+            auto halfWidth = 0.5 * (to - from), middle = 0.5 * (to + from);
+
+            for (int j = 0; j < 5; ++j)
+            {
+                auto t = middle + halfWidth * abscissae[j];
+                auto value = curve (t);
+
+                integral += weights[j] * halfWidth * value;
+                momentIntegral += weights[j] * halfWidth * t * value;
+            }
+        };
+
+        for (int direction : { 1, -1 })
+        {
+            auto integral = 0.0, momentIntegral = 0.0;
+
+            for (int i = centre; i >= 0 && i < numPoints; i += direction)
+            {
+                if (i != centre)
+                    integrateStep ((i - direction - centre) * h, (i - centre) * h, integral, momentIntegral);
+
+                auto x = (i - centre) * h;
+                nodes[(size_t) i].F1 = integral;
+                nodes[(size_t) i].F2 = x * integral - momentIntegral;
+            }
+        }
+    }
+
+    //==============================================================================
+    double f (double x) const noexcept
+    {
+        if (std::abs (x) >= range)
+            return nodes[(size_t) (x > 0.0 ? numPoints - 1 : 0)].f;
+
+        int index;
+        auto t = locate (x, index);
+        auto& a = nodes[(size_t) index];
+        auto& b = nodes[(size_t) index + 1];
+        auto h = 1.0 / pointsPerUnit;
+
+        // cubic Hermite
+        auto t2 = t * t, t3 = t2 * t;
+        return (2.0 * t3 - 3.0 * t2 + 1.0) * a.f + (t3 - 2.0 * t2 + t) * h * a.slope
+             + (3.0 * t2 - 2.0 * t3) * b.f + (t3 - t2) * h * b.slope;
+    }
+
+    double F1 (double x) const noexcept
+    {
+        if (std::abs (x) >= range)
+        {
+            auto& edge = nodes[(size_t) (x > 0.0 ? numPoints - 1 : 0)];
+            auto d = x - std::copysign (range, x);
+            return edge.F1 + edge.f * d;
+        }
+
+        int index;
+        auto t = locate (x, index);
+        auto& a = nodes[(size_t) index];
+        auto& b = nodes[(size_t) index + 1];
+        return quinticHermite (t, a.F1, a.f, a.slope, b.F1, b.f, b.slope);
+    }
+
+    double F2 (double x) const noexcept
+    {
+        if (std::abs (x) >= range)
+        {
+            auto& edge = nodes[(size_t) (x > 0.0 ? numPoints - 1 : 0)];
+            auto d = x - std::copysign (range, x);
+            return edge.F2 + edge.F1 * d + 0.5 * edge.f * d * d;
+        }
+
+        int index;
+        auto t = locate (x, index);
+        auto& a = nodes[(size_t) index];
+        auto& b = nodes[(size_t) index + 1];
+        return quinticHermite (t, a.F2, a.F1, a.f, b.F2, b.F1, b.f);
+    }
+
+private:
+    struct Node { double f, slope, F1, F2; };
+    std::array<Node, (size_t) numPoints> nodes;
+
+    static double locate (double x, int& index) noexcept
+    {
+        auto position = (x + range) * pointsPerUnit;
+        index = jlimit (0, numPoints - 2, (int) position);
+        return position - index;
+    }
+
+    /** Matches value, first and second derivative at both ends of a step of 1 / pointsPerUnit. */
+    static double quinticHermite (double t, double p0, double v0, double a0, double p1, double v1, double a1) noexcept
+    {
+        auto h = 1.0 / pointsPerUnit;
+        auto t2 = t * t, t3 = t2 * t, t4 = t3 * t, t5 = t4 * t;
+
+        return p0 * (1.0 - 10.0 * t3 + 15.0 * t4 - 6.0 * t5)
+             + h * v0 * (t - 6.0 * t3 + 8.0 * t4 - 3.0 * t5)
+             + h * h * a0 * 0.5 * (t2 - 3.0 * t3 + 3.0 * t4 - t5)
+             + h * h * a1 * 0.5 * (t3 - 2.0 * t4 + t5)
+             + h * v1 * (-4.0 * t3 + 7.0 * t4 - 3.0 * t5)
+             + p1 * (10.0 * t3 - 15.0 * t4 + 6.0 * t5);
+    }
+};
+
+//==============================================================================
+/**
+    A memoryless curve run at the audio rate makes harmonics above Nyquist,
+    which fold back as aliasing. ADAA replaces f(x[n]) with the average of f
+    over the straight line from the previous input to this one, worked out
+    exactly from an antiderivative:
+
+        first order   y = (F1(x[n]) - F1(x[n-1])) / (x[n] - x[n-1])
+        second order  the same again one level up, from F2 over x[n-2..n]
+
+    That removes most of the aliasing for the price of an antiderivative per
+    sample, rather than the 4-8x of oversampling. The cost is a little high
+    frequency roll-off and a delay of half a sample (first order) or one
+    sample (second order), which is too small to report as latency.
+
+    Every curve limits to +-1. Hard and cubic are polynomials and are worked
+    out directly; tanh and tube come from a WaveshaperTable. Each block
+    first evaluates the antiderivative of every sample in one loop, which is
+    where the cost is and which has no dependencies between samples, then
+    takes the differences in a second loop. For hard and cubic that first
+    loop is the processor's antiderivative kernel, in SIMD; the tables'
+    Hermite steps and the recursive second loop stay scalar.
+
+    Evaluation is in double: second order divides by the square of small
+    input steps, which single precision can't survive.
+*/
+class Waveshaper
+{
+public:
+    enum class Shape { hard, tanh, cubic, tube };
+    enum class Antialiasing { off, firstOrder, secondOrder };
+
+    Waveshaper() = default;
+
+    //==============================================================================
+    /** Also builds the shared tables the first time round, so the audio thread never does. */
+    void prepare (int maxSamplesPerBlock)
+    {
+        getTable (Shape::tanh);
+        getTable (Shape::tube);
+
+        antiderivatives.assign ((size_t) maxSamplesPerBlock, 0.0);
+        reset();
+    }
+
+    void setShape (Shape newShape, Antialiasing newAntialiasing) noexcept
+    {
+        if (newShape == shape && newAntialiasing == antialiasing)
+            return;
+
+        shape = newShape;
+        antialiasing = newAntialiasing;
+        reset();
+    }
+
+    /** A plain hard clip, which the processor's clip kernel can do instead. */
+    bool isHardClipOnly() const noexcept
+    {
+        return shape == Shape::hard && antialiasing == Antialiasing::off;
+    }
+
+    void reset() noexcept
+    {
+        x1 = x2 = 0.0;
+        previousAntiderivative = previousQuotient = 0.0;
+    }
+
+    //==============================================================================
+    void process (float* data, int numSamples, const DSPKernels::KernelTable& kernels) noexcept
+    {
+        switch (shape)
+        {
+            case Shape::tanh:   processCurve (TableCurve { getTable (Shape::tanh) }, data, numSamples, kernels); break;
+            case Shape::cubic:  processCurve (ClosedCurve<DSPKernels::ClosedFormCurve::cubic>(), data, numSamples, kernels); break;
+            case Shape::tube:   processCurve (TableCurve { getTable (Shape::tube) }, data, numSamples, kernels); break;
+            case Shape::hard:
+            default:            processCurve (ClosedCurve<DSPKernels::ClosedFormCurve::hard>(), data, numSamples, kernels); break;
+        }
+    }
+
+private:
+    //==============================================================================
+    // below this the difference quotients are ill-conditioned and the limit is used instead
+    static constexpr double tolerance = 1.0e-5;
+
+    Shape shape = Shape::hard;
+    Antialiasing antialiasing = Antialiasing::off;
+    std::vector<double> antiderivatives;
+    double x1 = 0.0, x2 = 0.0, previousAntiderivative = 0.0, previousQuotient = 0.0;
+
+    // hard is a plain clip; cubic is 1.5x - 0.5x^3 up to +-1, which meets the limit with zero slope
+    template <DSPKernels::ClosedFormCurve curve>
+    struct ClosedCurve
+    {
+        static double f (double x) noexcept
+        {
+            x = jlimit (-1.0, 1.0, x);
+            return curve == DSPKernels::ClosedFormCurve::hard ? x : 1.5 * x - 0.5 * x * x * x;
+        }
+
+        static double F1 (double x) noexcept     { return DSPKernels::closedFormAntiderivative (curve, 1, x); }
+        static double F2 (double x) noexcept     { return DSPKernels::closedFormAntiderivative (curve, 2, x); }
+
+        static void antiderivatives (const float* data, double* result, int numSamples, int order,
+                                     const DSPKernels::KernelTable& kernels) noexcept
+        {
+            kernels.antiderivative (data, result, numSamples, curve, order);
+        }
+    };
+
+    struct TableCurve
+    {
+        const WaveshaperTable& table;
+
+        double f (double x) const noexcept       { return table.f (x); }
+        double F1 (double x) const noexcept      { return table.F1 (x); }
+        double F2 (double x) const noexcept      { return table.F2 (x); }
+
+        void antiderivatives (const float* data, double* result, int numSamples, int order,
+                              const DSPKernels::KernelTable&) const noexcept
+        {
+            if (order == 1)
+                for (int i = 0; i < numSamples; ++i)
+                    result[i] = table.F1 (data[i]);
+            else
+                for (int i = 0; i < numSamples; ++i)
+                    result[i] = table.F2 (data[i]);
+        }
+    };
+
+    static const WaveshaperTable& getTable (Shape tableShape)
+    {
+        static const WaveshaperTable tanhTable ([] (double x) { return std::tanh (x); });
+
+        // tanh with a bias, so the negative half saturates later than the positive one;
+        // scaled so the negative side still tops out at -1
+        static const WaveshaperTable tubeTable ([] (double x)
+        {
+            constexpr double bias = 0.2;
+            auto offset = std::tanh (bias);
+            return (std::tanh (x + bias) - offset) / (1.0 + offset);
+        });
+
+        return tableShape == Shape::tube ? tubeTable : tanhTable;
+    }
+
+    //==============================================================================
+    template <typename Curve>
+    void processCurve (const Curve& curve, float* data, int numSamples, const DSPKernels::KernelTable& kernels) noexcept
+    {
+        jassert (numSamples <= (int) antiderivatives.size());
+        auto* ad = antiderivatives.data();
+
+        if (antialiasing == Antialiasing::off)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                data[i] = (float) curve.f (data[i]);
+
+            return;
+        }
+
+        if (antialiasing == Antialiasing::firstOrder)
+        {
+            curve.antiderivatives (data, ad, numSamples, 1, kernels);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                auto x0 = (double) data[i];
+                auto d = x0 - x1;
+
+                data[i] = (float) (std::abs (d) > tolerance ? (ad[i] - previousAntiderivative) / d
+                                                            : curve.f (0.5 * (x0 + x1)));
+                x1 = x0;
+                previousAntiderivative = ad[i];
+            }
+
+            return;
+        }
+
+        curve.antiderivatives (data, ad, numSamples, 2, kernels);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x0 = (double) data[i];
+            auto d = x0 - x1;
+            auto quotient = std::abs (d) > tolerance ? (ad[i] - previousAntiderivative) / d
+                                                     : curve.F1 (0.5 * (x0 + x1));
+            auto span = x0 - x2;
+            double y;
+
+            if (std::abs (span) > tolerance)
+            {
+                y = 2.0 * (quotient - previousQuotient) / span;
+            }
+            else
+            {
+                // x[n] is back where x[n-2] was, so expand around their midpoint instead
+                auto middle = 0.5 * (x0 + x2);
+                auto delta = middle - x1;
+
+                y = std::abs (delta) > tolerance ? 2.0 / delta * (curve.F1 (middle) + (previousAntiderivative - curve.F2 (middle)) / delta)
+                                                 : curve.f (0.5 * (middle + x1));
+            }
+
+            data[i] = (float) y;
+            x2 = x1;
+            x1 = x0;
+            previousAntiderivative = ad[i];
+            previousQuotient = quotient;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Waveshaper)
+};